@@ -55,7 +55,36 @@ end
 
 Transmog.prefix = "transmog"
 
+-- Version of the server messages this addon understands, agreed with the server on load
+Transmog.protocol = 5
+Transmog.serverProtocol = 1
+Transmog.handshakeReceived = false
+Transmog.collectionRequested = false
+-- Last page asked to a server that sends the lists by pages (protocol 3)
+Transmog.requestedPage = nil
+-- Last request sent of each command and the commands the server was too busy to answer
+Transmog.lastRequests = {}
+Transmog.busyRetries = {}
+-- Quality and inventory type of the items (inventoryType * 8 + quality) sent by servers with protocol 5,
+-- enough to show them without asking the server for every item
+Transmog.itemInfo = {}
+
+-- Packed ids are variable length numbers written with the printable characters except ':' and '|',
+-- the digits from 46 carry to the next one and each number is the zigzag encoded difference with the previous id
+Transmog.packedDigits = {}
+do
+    local digit = 0
+    for code = 33, 126 do
+        if code ~= 58 and code ~= 124 then
+            Transmog.packedDigits[code] = digit
+            digit = digit + 1
+        end
+    end
+end
+
 Transmog.availableTransmogItems = {}
+-- Position of the first item of availableTransmogItems in the whole list, only a page is kept when the server sends pages
+Transmog.availableTransmogOffset = {}
 Transmog.ItemButtons = {}
 Transmog.currentTransmogSlotName = nil
 Transmog.currentTransmogSlot = nil
@@ -65,6 +94,8 @@ Transmog.currentPage = 1
 Transmog.totalPages = 1
 Transmog.ipp = 15
 Transmog.numTransmogs = {}
+-- Items of the pages received so far of each list, only used when the server sends pages
+Transmog.receivedTransmogs = {}
 Transmog.transmogDataFromServer = {}
 Transmog.transmogStatusFromServer = {}
 Transmog.transmogStatusToServer = {}
@@ -374,6 +405,146 @@ Transmog:SetScript("OnEvent", function()
 				twfdebug("CHAT_MSG_ADDON " .. arg2)
 				
 				local message = arg2
+				if TransmogFrame_Find(message, "Busy:", 1, true) == 1 then
+
+					--Busy:command:retry delay in ms
+					local dataEx = TransmogFrame_Explode(message, ":")
+					if dataEx[2] then
+						Transmog:retryRequest(dataEx[2], (TransmogFrame_ToNumber(dataEx[3]) or 1000) / 1000)
+					end
+					return
+				end
+				if TransmogFrame_Find(message, "PackedTransmogs", 1, true) then
+
+					--PackedTransmogs:slot:itemClass+itemSubClass:amount:part:packed ids[:packed item infos]
+					--the first part resets the list, it is complete once every item has been received
+
+					local ex = TransmogFrame_Explode(message, ":")
+
+					local slot = TransmogFrame_ToNumber(ex[2])+1
+					local itemClass = TransmogFrame_ToNumber(ex[3])
+					local amount = TransmogFrame_ToNumber(ex[4])
+					local part = TransmogFrame_ToNumber(ex[5])
+
+					if not Transmog.numTransmogs[slot] then
+						Transmog.numTransmogs[slot] = {}
+					end
+
+					Transmog.numTransmogs[slot][itemClass] = amount
+
+					if not Transmog.transmogDataFromServer[slot] then
+						Transmog.transmogDataFromServer[slot] = {}
+					end
+					if part == 0 or not Transmog.transmogDataFromServer[slot][itemClass] then
+						Transmog.transmogDataFromServer[slot][itemClass] = {}
+					end
+
+					local itemIDs = Transmog:decodePackedIDs(ex[6] or "")
+					Transmog:setItemInfo(itemIDs, ex[7])
+					for _, itemID in itemIDs do
+						Transmog:addAvailableTransmog(slot, itemClass, itemID)
+					end
+
+					if table.getn(Transmog.transmogDataFromServer[slot][itemClass]) >= amount then
+						Transmog:prepareAvailableTransmogs(slot, itemClass)
+					end
+					return
+				end
+				if TransmogFrame_Find(message, "AddedTransmogs", 1, true) then
+
+					--AddedTransmogs:slot:itemClass+itemSubClass:amount:packed ids[:slot:itemClass+itemSubClass:amount:packed ids...]
+					--items discovered since the last message, amount is the size of the whole list
+
+					local ex = TransmogFrame_Explode(message, ":")
+
+					local i = 2
+					while ex[i + 3] do
+						local slot = TransmogFrame_ToNumber(ex[i])+1
+						local itemClass = TransmogFrame_ToNumber(ex[i + 1])
+						local amount = TransmogFrame_ToNumber(ex[i + 2])
+						Transmog:mergeAvailableTransmogs(slot, itemClass, amount, Transmog:decodePackedIDs(ex[i + 3]))
+						i = i + 4
+					end
+					return
+				end
+				if TransmogFrame_Find(message, "TransmogPage", 1, true) then
+
+					--TransmogPage:slot:itemClass+itemSubClass:page:total:packed ids[:packed item infos]
+
+					local ex = TransmogFrame_Explode(message, ":")
+
+					local slot = TransmogFrame_ToNumber(ex[2])+1
+					local itemClass = TransmogFrame_ToNumber(ex[3])
+					local page = TransmogFrame_ToNumber(ex[4])
+					local total = TransmogFrame_ToNumber(ex[5])
+
+					if not Transmog.numTransmogs[slot] then
+						Transmog.numTransmogs[slot] = {}
+					end
+
+					Transmog.numTransmogs[slot][itemClass] = total
+
+					-- The pages received before the list changed no longer count
+					if not Transmog.receivedTransmogs[slot] then
+						Transmog.receivedTransmogs[slot] = {}
+					end
+					local received = Transmog.receivedTransmogs[slot][itemClass]
+					if not received or received.total ~= total then
+						received = { ['total'] = total, ['pages'] = {} }
+						Transmog.receivedTransmogs[slot][itemClass] = received
+					end
+
+					-- Keep the whole list if it has already been received
+					if Transmog.transmogDataFromServer[slot] and Transmog.transmogDataFromServer[slot][itemClass] and table.getn(Transmog.transmogDataFromServer[slot][itemClass]) >= total then
+						Transmog:prepareAvailableTransmogs(slot, itemClass)
+					else
+						local itemIDs = Transmog:decodePackedIDs(ex[6] or "")
+						Transmog:setItemInfo(itemIDs, ex[7])
+						received.pages[page] = table.getn(itemIDs)
+						for _, itemID in itemIDs do
+							if not Transmog.itemInfo[itemID] then
+								Transmog:cacheItem(itemID)
+							end
+						end
+						Transmog:prepareAvailableTransmogs(slot, itemClass, itemIDs, (page - 1) * Transmog.ipp)
+					end
+
+					Transmog:renderCurrentTransmogs(slot, itemClass)
+					return
+				end
+				if TransmogFrame_Find(message, "TransmogSync", 1, true) then
+
+					--TransmogSync:full          the stored collection is dropped, every list follows
+					--TransmogSync:delta         the stored collection is used, the lists that changed follow
+					--TransmogSync:current       the stored collection is up to date
+					--TransmogSync:version:hex   version of the collection once everything before has been received
+
+					local dataEx = TransmogFrame_Explode(message, ":")
+					if dataEx[2] == "version" then
+						if transmogCollectionCache then
+							transmogCollectionCache.version = dataEx[3]
+						end
+					elseif dataEx[2] == "full" then
+						Transmog:resetCollectionCache()
+					else
+						Transmog:restoreCollectionCache()
+					end
+					return
+				end
+				if TransmogFrame_Find(message, "Handshake", 1, true) then
+					-- Handshake:protocol
+					local dataEx = TransmogFrame_Explode(message, ":")
+					Transmog.serverProtocol = TransmogFrame_ToNumber(dataEx[2]) or 1
+					twfdebug("Handshake protocol " .. Transmog.serverProtocol)
+
+					-- Servers that send pages only send the items shown
+					Transmog.handshakeReceived = true
+					Transmog.handshakeDelay:Hide()
+					if Transmog.serverProtocol < 3 then
+						Transmog:requestCollection()
+					end
+					return
+				end
 				if TransmogFrame_Find(message, "AvailableTransmogs", 1, true) then
 
 					--AvailableTransmogs:slot:itemClass+itemSubClass:amount:start
@@ -404,20 +575,7 @@ Transmog:SetScript("OnEvent", function()
 							if i > 4 then
 								itemID = TransmogFrame_ToNumber(itemID)
 								if itemID ~= 0 then
-									Transmog:cacheItem(itemID)
-
-									table.insert(Transmog.transmogDataFromServer[slot][itemClass], itemID)
-
-									if not Transmog.currentTransmogsData[slot] then
-										Transmog.currentTransmogsData[slot] = {}
-									end
-									if not Transmog.currentTransmogsData[slot][itemClass] then
-										Transmog.currentTransmogsData[slot][itemClass] = {}
-									end
-									table.insert(Transmog.currentTransmogsData[slot][itemClass], {
-										['id'] = TransmogFrame_ToNumber(itemID),
-										['has'] = false
-									})
+									Transmog:addAvailableTransmog(slot, itemClass, itemID)
 								end
 							end
 						end
@@ -635,8 +793,10 @@ end
 function Transmog:LoadOnce()
 
 	twfdebug("LoadOnce")
+    self:aSend("Handshake " .. self.protocol)
     self:aSend("GetTransmogStatus")
-	self:aSend("GetAvailableTransmogs")
+	-- The whole collection is only needed if the server can not send it by pages
+	self.handshakeDelay:Show()
     --self:aSend("GetSetsStatus:")
 end
 
@@ -731,10 +891,258 @@ function Transmog:Reset(once)
 
 end
 
+function Transmog:addAvailableTransmog(slot, itemClass, itemID)
+    if not self.itemInfo[itemID] then
+        self:cacheItem(itemID)
+    end
+
+    table.insert(self.transmogDataFromServer[slot][itemClass], itemID)
+
+    if not self.currentTransmogsData[slot] then
+        self.currentTransmogsData[slot] = {}
+    end
+    if not self.currentTransmogsData[slot][itemClass] then
+        self.currentTransmogsData[slot][itemClass] = {}
+    end
+    table.insert(self.currentTransmogsData[slot][itemClass], {
+        ['id'] = itemID,
+        ['has'] = false
+    })
+end
+
+function Transmog:mergeAvailableTransmogs(slot, itemClass, amount, itemIDs)
+    if not self.numTransmogs[slot] then
+        self.numTransmogs[slot] = {}
+    end
+
+    self.numTransmogs[slot][itemClass] = amount
+
+    if not self.transmogDataFromServer[slot] or not self.transmogDataFromServer[slot][itemClass] then
+        -- Only pages of the list have been received, ask again for the one shown
+        if not self.collectionRequested then
+            self.requestedPage = nil
+            if self.availableTransmogItems[slot] then
+                self.availableTransmogItems[slot][itemClass] = nil
+            end
+            self:renderCurrentTransmogs(slot, itemClass)
+            return
+        end
+
+        if not self.transmogDataFromServer[slot] then
+            self.transmogDataFromServer[slot] = {}
+        end
+        self.transmogDataFromServer[slot][itemClass] = {}
+    end
+
+    for _, itemID in itemIDs do
+        local known = false
+        for _, knownID in self.transmogDataFromServer[slot][itemClass] do
+            if knownID == itemID then
+                known = true
+                break
+            end
+        end
+        if not known then
+            self:addAvailableTransmog(slot, itemClass, itemID)
+        end
+    end
+
+    self:prepareAvailableTransmogs(slot, itemClass)
+    self:renderCurrentTransmogs(slot, itemClass)
+end
+
+function Transmog:requestCollection()
+    if self.collectionRequested then
+        return
+    end
+
+    self.collectionRequested = true
+
+	-- The server only sends what changed since the collection stored on the previous session
+	if transmogCollectionCache and transmogCollectionCache.version and transmogCollectionCache.data then
+		self:aSend("GetAvailableTransmogs " .. transmogCollectionCache.version)
+	else
+		self:aSend("GetAvailableTransmogs 0")
+	end
+end
+
+function Transmog:requestTransmogPage(slot, itemClass, page)
+    -- GetAvailableTransmogsPage slot:itemClass+itemSubClass:page:pageSize
+    local request = (slot - 1) .. ":" .. itemClass .. ":" .. page .. ":" .. self.ipp
+    if self.requestedPage ~= request then
+        self.requestedPage = request
+        self:aSend("GetAvailableTransmogsPage " .. request)
+    end
+end
+
+function Transmog:retryRequest(command, delay)
+    twfdebug("retryRequest " .. command .. " in " .. delay)
+
+    -- Everything the server refused is sent again together once the longest wait is over
+    self.busyRetries[command] = true
+    if self.retryDelay:IsVisible() then
+        self.retryDelay.delay = math.max(self.retryDelay.delay, GetTime() - self.retryDelay.startTime + delay)
+    else
+        self.retryDelay.delay = delay
+        self.retryDelay:Show()
+    end
+end
+
+function Transmog:availableTransmogsTotal(slot, itemClass)
+    if self.numTransmogs[slot] and self.numTransmogs[slot][itemClass] then
+        return self.numTransmogs[slot][itemClass]
+    end
+    return 0
+end
+
+function Transmog:availableTransmogsReceived(slot, itemClass)
+    local received = 0
+    if self.transmogDataFromServer[slot] and self.transmogDataFromServer[slot][itemClass] then
+        received = table.getn(self.transmogDataFromServer[slot][itemClass])
+    end
+
+    -- Paged lists count the items of every page received so far
+    if self.receivedTransmogs[slot] and self.receivedTransmogs[slot][itemClass] then
+        local pageItems = 0
+        for _, amount in self.receivedTransmogs[slot][itemClass].pages do
+            pageItems = pageItems + amount
+        end
+        received = math.max(received, pageItems)
+    end
+
+    return math.min(received, self:availableTransmogsTotal(slot, itemClass))
+end
+
+function Transmog:availableTransmogsOffset(slot, itemClass)
+    if self.availableTransmogOffset[slot] and self.availableTransmogOffset[slot][itemClass] then
+        return self.availableTransmogOffset[slot][itemClass]
+    end
+    return 0
+end
+
+function Transmog:isPageAvailable(slot, itemClass, page)
+    if self.serverProtocol < 3 then
+        return true
+    end
+
+    if not self.availableTransmogItems[slot] or not self.availableTransmogItems[slot][itemClass] then
+        return false
+    end
+
+    local first = (page - 1) * self.ipp
+    local last = math.min(first + self.ipp, self:availableTransmogsTotal(slot, itemClass))
+    local offset = self:availableTransmogsOffset(slot, itemClass)
+    return first >= offset and last <= offset + table.getn(self.availableTransmogItems[slot][itemClass])
+end
+
+function Transmog:renderCurrentTransmogs(slot, itemClass)
+    if self.tab == 'items' and self.currentTransmogSlot == slot and self.currentTransmogItemClass == itemClass then
+        self:renderAvailableTransmogs(slot, itemClass)
+    end
+end
+
+function Transmog:resetCollectionCache()
+    self.transmogDataFromServer = {}
+    self.numTransmogs = {}
+    self.receivedTransmogs = {}
+    self.itemInfo = {}
+
+    -- The saved collection is the same table the server lists are received in
+    transmogCollectionCache = {
+        ['data'] = self.transmogDataFromServer,
+        ['info'] = self.itemInfo
+    }
+end
+
+function Transmog:restoreCollectionCache()
+    if not transmogCollectionCache or not transmogCollectionCache.data then
+        self:resetCollectionCache()
+        return
+    end
+
+    if transmogCollectionCache.data == self.transmogDataFromServer then
+        return
+    end
+
+    local cachedData = transmogCollectionCache.data
+    local cachedInfo = transmogCollectionCache.info
+    self:resetCollectionCache()
+
+    -- Collections saved before the server sent the item info ask for their items as before
+    if cachedInfo then
+        self.itemInfo = cachedInfo
+        transmogCollectionCache.info = cachedInfo
+    end
+
+    for slot, itemClasses in cachedData do
+        self.transmogDataFromServer[slot] = {}
+        self.numTransmogs[slot] = {}
+        for itemClass, itemIDs in itemClasses do
+            self.transmogDataFromServer[slot][itemClass] = {}
+            self.numTransmogs[slot][itemClass] = table.getn(itemIDs)
+            for _, itemID in itemIDs do
+                self:addAvailableTransmog(slot, itemClass, itemID)
+            end
+            self:prepareAvailableTransmogs(slot, itemClass)
+        end
+    end
+end
+
+function Transmog:decodePackedNumbers(packed)
+    local values = {}
+    local value, scale = 0, 1
+    for i = 1, string.len(packed) do
+        local digit = self.packedDigits[string.byte(packed, i)]
+        if not digit then
+            twfdebug("invalid packed digit " .. string.sub(packed, i, i))
+            return values
+        end
+        if digit >= 46 then
+            value = value + (digit - 46) * scale
+            scale = scale * 46
+        else
+            table.insert(values, value + digit * scale)
+            value, scale = 0, 1
+        end
+    end
+    return values
+end
+
+function Transmog:decodePackedIDs(packed)
+    local itemIDs = self:decodePackedNumbers(packed)
+    local itemID = 0
+    for i, value in itemIDs do
+        if math.mod(value, 2) == 1 then
+            itemID = itemID - (value + 1) / 2
+        else
+            itemID = itemID + value / 2
+        end
+        itemIDs[i] = itemID
+    end
+    return itemIDs
+end
+
+function Transmog:setItemInfo(itemIDs, packedInfo)
+    if not packedInfo then
+        return
+    end
+
+    -- Same order as the ids of the message
+    for i, info in self:decodePackedNumbers(packedInfo) do
+        if itemIDs[i] then
+            self.itemInfo[itemIDs[i]] = info
+        end
+    end
+end
+
 function Transmog:aSend(data)
     if self.localCache[data] then
         twfdebug("|cff69ccf0 not send " .. data .. " data cached")
     else
+        local _, _, command = TransmogFrame_Find(data, "^(%S+)")
+        if command then
+            self.lastRequests[command] = data
+        end
 		SendChatMessage("." .. self.prefix .. " " .. data)
         twfdebug("|cff69ccf0 send -> " .. data)
     end
@@ -761,6 +1169,8 @@ Transmog.availableTransmogsCacheDelay:Hide()
 
 Transmog.availableTransmogsCacheDelay.InventorySlotId = 0
 Transmog.availableTransmogsCacheDelay.ItemClass = 0
+Transmog.availableTransmogsCacheDelay.ItemIDs = nil
+Transmog.availableTransmogsCacheDelay.Offset = 0
 
 Transmog.availableTransmogsCacheDelay:SetScript("OnShow", function()
     this.startTime = GetTime()
@@ -773,12 +1183,14 @@ Transmog.availableTransmogsCacheDelay:SetScript("OnUpdate", function()
     if gt >= st then
 
         twfdebug("delay cache: " .. Transmog.availableTransmogsCacheDelay.InventorySlotId)
-        Transmog:prepareAvailableTransmogs(Transmog.availableTransmogsCacheDelay.InventorySlotId, Transmog.availableTransmogsCacheDelay.ItemClass)
-        Transmog.availableTransmogsCacheDelay:Hide()
+        local delay = Transmog.availableTransmogsCacheDelay
+        delay:Hide()
+        Transmog:prepareAvailableTransmogs(delay.InventorySlotId, delay.ItemClass, delay.ItemIDs, delay.Offset)
+        Transmog:renderCurrentTransmogs(delay.InventorySlotId, delay.ItemClass)
     end
 end)
 
-function Transmog:prepareAvailableTransmogs(slot, itemClass)
+function Transmog:prepareAvailableTransmogs(slot, itemClass, itemIDs, offset)
 
 	twfdebug("prepareAvailableTransmogs start slot: " .. slot .. " itemClass: " .. itemClass)
 
@@ -788,9 +1200,28 @@ function Transmog:prepareAvailableTransmogs(slot, itemClass)
 
     self.availableTransmogItems[slot][itemClass] = {}
 
-    for i, itemID in self.transmogDataFromServer[slot][itemClass] do
+    -- A page of the list, or the whole list received from the server
+    if not itemIDs then
+        itemIDs = self.transmogDataFromServer[slot][itemClass]
+        offset = 0
+    end
+
+    if not self.availableTransmogOffset[slot] then
+        self.availableTransmogOffset[slot] = {}
+    end
+    self.availableTransmogOffset[slot][itemClass] = offset
+
+    for i, itemID in itemIDs do
         itemID = TransmogFrame_ToNumber(itemID)
         local name, link, quality, _, xt1, xt2, _, equip_slot, xtex = GetItemInfo(itemID)
+        local inventoryType = self.invTypes[equip_slot]
+
+        -- Items the server sent the info of are shown without waiting for the client item cache
+        local info = self.itemInfo[itemID]
+        if not name and info then
+            quality = math.mod(info, 8)
+            inventoryType = math.floor(info / 8)
+        end
 		--local itemName, a1, a2, a3, itemClass, itemSubclass, a6, invType = GetItemInfo(eqItemLink)
 		
 		-- This will fail if the item is not currently equipped
@@ -801,16 +1232,18 @@ function Transmog:prepareAvailableTransmogs(slot, itemClass)
 			eqItemLink = eqItemLink2;
 		end
 
-        if not name then
+        if not name and not info then
             self:cacheItem(itemID);
             twfdebug("caching item " .. itemID)
             Transmog.availableTransmogsCacheDelay.InventorySlotId = slot
 			Transmog.availableTransmogsCacheDelay.ItemClass = itemClass
+            Transmog.availableTransmogsCacheDelay.ItemIDs = itemIDs
+            Transmog.availableTransmogsCacheDelay.Offset = offset
             Transmog.availableTransmogsCacheDelay:Show()
             return
         end
 
-        if name then
+        if name or info then
 			local reset = false
 			if eqItemLink then
 				reset = itemID == self:IDFromLink(eqItemLink)
@@ -824,6 +1257,7 @@ function Transmog:prepareAvailableTransmogs(slot, itemClass)
                 ['t1'] = xt1,
                 ['t2'] = xt2,
                 ['equip_slot'] = equip_slot,
+                ['inventoryType'] = inventoryType,
                 ['tex'] = xtex,
                 ['itemLink'] = eqItemLink
             })
@@ -840,17 +1274,26 @@ function Transmog:renderAvailableTransmogs(slot, itemClass)
     -- hide all item buttons
     self:hideItems(true)
     self:hideItemBorders()
-	
-	if not self.transmogDataFromServer[slot] then
-		return
-	end
 
-    self:setProgressBar(self:tableSize(self.transmogDataFromServer[slot][itemClass]), self.numTransmogs[slot][itemClass])
-    if self:tableSize(self.transmogDataFromServer[slot][itemClass]) == 0 then
+    -- Updated again with every page received
+    local total = self:availableTransmogsTotal(slot, itemClass)
+    self:setProgressBar(self:availableTransmogsReceived(slot, itemClass), total)
+
+    -- Ask for the page if the server only sends the items shown
+    if not self:isPageAvailable(slot, itemClass, self.currentPage) then
+        self:requestTransmogPage(slot, itemClass, self.currentPage)
+        return
+    end
+
+    if total == 0 then
         TransmogFrameNoTransmogs:Show()
     end
 
-    local index = 0
+	if not self.availableTransmogItems[slot] or not self.availableTransmogItems[slot][itemClass] then
+		return
+	end
+
+    local index = self:availableTransmogsOffset(slot, itemClass)
     local row = 0
     local col = 0
     local itemIndex = 1
@@ -880,7 +1323,11 @@ function Transmog:renderAvailableTransmogs(slot, itemClass)
             end
 
             local _, _, _, color = GetItemQualityColor(item.quality)
-            AddButtonOnEnterTextTooltip(getglobal('TransmogLook' .. itemIndex .. 'Button'), color .. item.name)
+            if item.name then
+                AddButtonOnEnterTextTooltip(getglobal('TransmogLook' .. itemIndex .. 'Button'), color .. item.name)
+            else
+                AddButtonOnEnterItemTooltip(getglobal('TransmogLook' .. itemIndex .. 'Button'), item.id, color)
+            end
             if item.reset then
                 getglobal('TransmogLook' .. itemIndex .. 'ButtonRevert'):Show()
             end
@@ -1080,7 +1527,7 @@ function Transmog:renderAvailableTransmogs(slot, itemClass)
             -- ranged
             if self.currentTransmogSlot == self.inventorySlots['RangedSlot'] then
                 model:SetRotation(-0.61)
-                if self.invTypes[item.equip_slot] == C_INVTYPE_RANGEDRIGHT then
+                if item.inventoryType == C_INVTYPE_RANGEDRIGHT then
                     model:SetRotation(0.61);
                 end
                 if self.race == 'troll' then
@@ -1115,7 +1562,7 @@ function Transmog:renderAvailableTransmogs(slot, itemClass)
         index = index + 1
     end
 
-    self.totalPages = self:ceil(self:tableSize(self.availableTransmogItems[slot][itemClass]) / self.ipp)
+    self.totalPages = self:ceil(total / self.ipp)
 
     TransmogFramePageText:SetText("Page " .. self.currentPage .. "/" .. self.totalPages)
 
@@ -1125,7 +1572,7 @@ function Transmog:renderAvailableTransmogs(slot, itemClass)
         TransmogFrameLeftArrow:Enable()
     end
 
-    if self.currentPage == self.totalPages or self:tableSize(self.availableTransmogItems[slot][itemClass]) < self.ipp then
+    if self.currentPage == self.totalPages or total < self.ipp then
         TransmogFrameRightArrow:Disable()
     else
         TransmogFrameRightArrow:Enable()
@@ -1842,6 +2289,24 @@ function TransmogModel_OnLoad()
     TransmogFramePlayerModel:SetRotation(TransmogFramePlayerModel.rotation);
 end
 
+-- The item is only asked to the server when hovered if it is not in the client item cache yet
+function AddButtonOnEnterItemTooltip(frame, itemID, color)
+    frame:SetScript("OnEnter", function(self)
+        FashionTooltip:SetOwner(this, "ANCHOR_RIGHT", -(this:GetWidth() / 4) + 15, -(this:GetHeight() / 4) + 20)
+
+        local name = GetItemInfo(itemID)
+        if name then
+            FashionTooltip:AddLine(HIGHLIGHT_FONT_COLOR_CODE .. color .. name)
+        else
+            FashionTooltip:SetHyperlink("item:" .. itemID .. ":0:0:0")
+        end
+        FashionTooltip:Show()
+    end)
+    frame:SetScript("OnLeave", function(self)
+        FashionTooltip:Hide()
+    end)
+end
+
 function AddButtonOnEnterTextTooltip(frame, text, ext, error, anchor, x, y)
     frame:SetScript("OnEnter", function(self)
         if anchor and x and y then
@@ -1934,6 +2399,9 @@ function Transmog_switchTab(to)
 
     Transmog.tab = to
     if to == 'items' then
+        -- Ask again for the page shown, the equipped items may have changed
+        Transmog.requestedPage = nil
+
         TransmogFrameItemsButton:SetNormalTexture('Interface\\AddOns\\Transmog\\TransmogFrame\\tab_active')
         TransmogFrameItemsButton:SetPushedTexture('Interface\\AddOns\\Transmog\\TransmogFrame\\tab_active')
         TransmogFrameItemsButtonText:SetText(HIGHLIGHT_FONT_COLOR_CODE .. 'Items')
@@ -1950,6 +2418,9 @@ function Transmog_switchTab(to)
 
     elseif to == 'sets' then
 
+        -- Sets need the whole collection
+        Transmog:requestCollection()
+
         selectTransmogSlot(-1)
 
         TransmogFrameSplash:Hide()
@@ -2361,6 +2832,52 @@ Transmog.delayAddWonItem:SetScript("OnUpdate", function()
     end
 end)
 
+Transmog.handshakeDelay = CreateFrame("Frame")
+Transmog.handshakeDelay:Hide()
+Transmog.handshakeDelay.delay = 5
+
+Transmog.handshakeDelay:SetScript("OnShow", function()
+    this.startTime = GetTime()
+end)
+Transmog.handshakeDelay:SetScript("OnUpdate", function()
+    local gt = GetTime() * 1000
+    local st = (this.startTime + Transmog.handshakeDelay.delay) * 1000
+    if gt >= st then
+        Transmog.handshakeDelay:Hide()
+
+        -- Servers without the handshake only send the whole collection
+        if not Transmog.handshakeReceived then
+            Transmog:requestCollection()
+        end
+    end
+end)
+
+Transmog.retryDelay = CreateFrame("Frame")
+Transmog.retryDelay:Hide()
+Transmog.retryDelay.delay = 1
+
+Transmog.retryDelay:SetScript("OnShow", function()
+    this.startTime = GetTime()
+end)
+Transmog.retryDelay:SetScript("OnUpdate", function()
+    local gt = GetTime() * 1000
+    local st = (this.startTime + Transmog.retryDelay.delay) * 1000
+    if gt >= st then
+        Transmog.retryDelay:Hide()
+
+        local retries = Transmog.busyRetries
+        Transmog.busyRetries = {}
+        for command in retries do
+            if command == "ApplyTransmog" then
+                -- Never buy on its own, the cost enables the button again
+                Transmog:calculateCost()
+            elseif Transmog.lastRequests[command] then
+                Transmog:aSend(Transmog.lastRequests[command])
+            end
+        end
+    end
+end)
+
 Transmog.gearChangedDelay = CreateFrame("Frame")
 Transmog.gearChangedDelay:Hide()
 Transmog.gearChangedDelay.delay = 1
@@ -12,4 +12,29 @@ CREATE TABLE `custom_transmog_discovered` (
   `player` int(11) unsigned NOT NULL,
   `item_entry` int(11) unsigned NOT NULL,
   PRIMARY KEY (`player`, `item_entry`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
+DROP TABLE IF EXISTS `custom_transmog_collection`;
+CREATE TABLE `custom_transmog_collection` (
+  `player` int(11) unsigned NOT NULL,
+  `version` tinyint(3) unsigned NOT NULL DEFAULT '1',
+  `segments` int(11) unsigned NOT NULL DEFAULT '1',
+  `data` mediumblob NOT NULL,
+  PRIMARY KEY (`player`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
+DROP TABLE IF EXISTS `custom_transmog_account_discovered`;
+CREATE TABLE `custom_transmog_account_discovered` (
+  `account` int(11) unsigned NOT NULL,
+  `item_entry` int(11) unsigned NOT NULL,
+  PRIMARY KEY (`account`, `item_entry`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
+DROP TABLE IF EXISTS `custom_transmog_account_collection`;
+CREATE TABLE `custom_transmog_account_collection` (
+  `account` int(11) unsigned NOT NULL,
+  `version` tinyint(3) unsigned NOT NULL DEFAULT '1',
+  `segments` int(11) unsigned NOT NULL DEFAULT '1',
+  `data` mediumblob NOT NULL,
+  PRIMARY KEY (`account`)
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8;
\ No newline at end of file
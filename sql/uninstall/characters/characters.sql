@@ -1,2 +1,5 @@
 DROP TABLE IF EXISTS `custom_transmog_active`;
-DROP TABLE IF EXISTS `custom_transmog_discovered`;
\ No newline at end of file
+DROP TABLE IF EXISTS `custom_transmog_discovered`;
+DROP TABLE IF EXISTS `custom_transmog_collection`;
+DROP TABLE IF EXISTS `custom_transmog_account_discovered`;
+DROP TABLE IF EXISTS `custom_transmog_account_collection`;
\ No newline at end of file
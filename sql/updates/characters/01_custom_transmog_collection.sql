@@ -0,0 +1,7 @@
+CREATE TABLE IF NOT EXISTS `custom_transmog_collection` (
+  `player` int(11) unsigned NOT NULL,
+  `version` tinyint(3) unsigned NOT NULL DEFAULT '1',
+  `segments` int(11) unsigned NOT NULL DEFAULT '1',
+  `data` mediumblob NOT NULL,
+  PRIMARY KEY (`player`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
\ No newline at end of file
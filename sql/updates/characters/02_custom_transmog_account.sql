@@ -0,0 +1,13 @@
+CREATE TABLE IF NOT EXISTS `custom_transmog_account_discovered` (
+  `account` int(11) unsigned NOT NULL,
+  `item_entry` int(11) unsigned NOT NULL,
+  PRIMARY KEY (`account`, `item_entry`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
+CREATE TABLE IF NOT EXISTS `custom_transmog_account_collection` (
+  `account` int(11) unsigned NOT NULL,
+  `version` tinyint(3) unsigned NOT NULL DEFAULT '1',
+  `segments` int(11) unsigned NOT NULL DEFAULT '1',
+  `data` mediumblob NOT NULL,
+  PRIMARY KEY (`account`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef CMANGOS_MODULE_TRANSMOG_ADDON_MESSAGE_H
+#define CMANGOS_MODULE_TRANSMOG_ADDON_MESSAGE_H
+
+#include "TransmogAddonProtocol.h"
+
+#include <cstring>
+#include <string>
+
+namespace cmangos_module
+{
+    // Addon message written in place, numbers included, so building it does not allocate.
+    // It holds as much text as the client accepts after the prefix, anything written past that is dropped.
+    class TransmogAddonMessage
+    {
+    public:
+        TransmogAddonMessage() : length(0), truncated(false) { text[0] = '\0'; }
+
+        TransmogAddonMessage& operator<<(const char* value)
+        {
+            Append(value, strlen(value));
+            return *this;
+        }
+
+        TransmogAddonMessage& operator<<(const std::string& value)
+        {
+            Append(value.c_str(), value.size());
+            return *this;
+        }
+
+        TransmogAddonMessage& operator<<(char value)
+        {
+            Append(&value, 1);
+            return *this;
+        }
+
+        TransmogAddonMessage& operator<<(uint32 value)
+        {
+            char digits[10];
+            uint32 amount = 0;
+            do
+            {
+                digits[sizeof(digits) - ++amount] = char('0' + value % 10);
+                value /= 10;
+            }
+            while (value);
+
+            Append(digits + sizeof(digits) - amount, amount);
+            return *this;
+        }
+
+        // Used by AppendPackedID
+        TransmogAddonMessage& operator+=(char value) { return *this << value; }
+
+        // Fixed width upper case hexadecimal (same as %08X)
+        void AppendHex(uint32 value)
+        {
+            static const char hexDigits[] = "0123456789ABCDEF";
+            char digits[8];
+            for (int32 i = 7; i >= 0; --i)
+            {
+                digits[i] = hexDigits[value & 0xF];
+                value >>= 4;
+            }
+
+            Append(digits, sizeof(digits));
+        }
+
+        void Clear()
+        {
+            length = 0;
+            truncated = false;
+            text[0] = '\0';
+        }
+
+        const char* c_str() const { return text; }
+        size_t size() const { return length; }
+        bool IsTruncated() const { return truncated; }
+
+    private:
+        void Append(const char* value, size_t valueLength)
+        {
+            if (length + valueLength > TRANSMOG_ADDON_TEXT_LIMIT)
+            {
+                valueLength = TRANSMOG_ADDON_TEXT_LIMIT - length;
+                truncated = true;
+            }
+
+            memcpy(text + length, value, valueLength);
+            length += valueLength;
+            text[length] = '\0';
+        }
+
+    private:
+        char text[TRANSMOG_ADDON_TEXT_LIMIT + 1];
+        size_t length;
+        bool truncated;
+    };
+}
+#endif
\ No newline at end of file
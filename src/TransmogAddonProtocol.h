@@ -0,0 +1,86 @@
+#ifndef CMANGOS_MODULE_TRANSMOG_ADDON_PROTOCOL_H
+#define CMANGOS_MODULE_TRANSMOG_ADDON_PROTOCOL_H
+
+#include "Platform/Define.h"
+
+#include <string>
+
+namespace cmangos_module
+{
+    // Versions of the messages sent to the client addon, agreed with the Handshake command.
+    // Addons that never send it keep receiving the text messages.
+    enum TransmogAddonProtocol
+    {
+        TRANSMOG_PROTOCOL_TEXT = 1,   // AvailableTransmogs:slot:class:amount:id1:id2... framed by start/end messages
+        TRANSMOG_PROTOCOL_PACKED = 2, // PackedTransmogs:slot:class:amount:part:packed ids
+        TRANSMOG_PROTOCOL_PAGED = 3,  // Packed messages, the addon asks for the pages it shows (GetAvailableTransmogsPage)
+        TRANSMOG_PROTOCOL_DELTA = 4,  // AddedTransmogs:slot:class:amount:packed ids... with the items discovered since the last world update
+        TRANSMOG_PROTOCOL_ITEM_INFO = 5, // PackedTransmogs and TransmogPage end with the packed item info of their items (:packed infos)
+    };
+
+    constexpr uint8 TRANSMOG_PROTOCOL_LATEST = TRANSMOG_PROTOCOL_ITEM_INFO;
+
+    // Equipment slots the addon and the server talk about, same as EQUIPMENT_SLOT_END (checked by the module)
+    constexpr uint8 TRANSMOG_EQUIPMENT_SLOTS = 19;
+
+    // Most items returned by a single GetAvailableTransmogsPage (one addon message)
+    constexpr uint32 TRANSMOG_MAX_PAGE_SIZE = 25;
+
+    // Longest addon message the client accepts (prefix, separator and text)
+    constexpr uint32 TRANSMOG_ADDON_MESSAGE_LIMIT = 254;
+
+    // Prefix of the addon messages (and the chat commands) of the module
+    constexpr char TRANSMOG_ADDON_PREFIX[] = "transmog";
+
+    // Longest text of an addon message, what is left once the prefix and its separator are added
+    constexpr uint32 TRANSMOG_ADDON_TEXT_LIMIT = TRANSMOG_ADDON_MESSAGE_LIMIT - (sizeof(TRANSMOG_ADDON_PREFIX) - 1) - 1;
+
+    // The packed ids are variable length numbers written with the printable characters except ':' and '|'.
+    // Half of the 92 digits end a number and the other half carry 46 more values to the next digit.
+    constexpr uint32 TRANSMOG_PACKED_BASE = 46;
+
+    // A packed id takes at most 6 digits (zigzag of a 32 bits difference)
+    constexpr uint32 TRANSMOG_MAX_PACKED_ID_LENGTH = 6;
+
+    // A packed item info takes at most 2 digits
+    constexpr uint32 TRANSMOG_MAX_PACKED_INFO_LENGTH = 2;
+
+    inline char GetPackedDigit(uint32 value)
+    {
+        // Skips ':' (58) and '|' (124)
+        char digit = char(33 + value);
+        if (digit >= ':')
+            digit++;
+        if (digit >= '|')
+            digit++;
+        return digit;
+    }
+
+    template <class Out>
+    inline void AppendPackedNumber(Out& out, uint64 value)
+    {
+        while (value >= TRANSMOG_PACKED_BASE)
+        {
+            out += GetPackedDigit(TRANSMOG_PACKED_BASE + value % TRANSMOG_PACKED_BASE);
+            value /= TRANSMOG_PACKED_BASE;
+        }
+
+        out += GetPackedDigit(uint32(value));
+    }
+
+    // Appends the difference with the previous id (zigzag encoded as the equipped item goes first)
+    template <class Out>
+    inline void AppendPackedID(Out& out, uint32 itemID, uint32& previousItemID)
+    {
+        const int64 delta = int64(itemID) - int64(previousItemID);
+        AppendPackedNumber(out, delta < 0 ? uint64(-delta) * 2 - 1 : uint64(delta) * 2);
+        previousItemID = itemID;
+    }
+
+    // What the addon needs to show an item without asking the client item cache (the name is only looked up when hovered)
+    inline uint32 GetPackedItemInfo(uint8 inventoryType, uint8 quality)
+    {
+        return uint32(inventoryType) * 8 + (quality & 7);
+    }
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include "TransmogAppearanceIndex.h"
+
+#include <algorithm>
+
+namespace cmangos_module
+{
+    constexpr uint32 InitialBuckets = 1024;
+    constexpr uint32 InitialBucketBits = 10;
+    static_assert(InitialBuckets == 1U << InitialBucketBits, "The appearance index needs a power of two amount of buckets");
+
+    TransmogAppearanceIndex::TransmogAppearanceIndex()
+    : buckets(InitialBuckets, { 0, 0, 0 })
+    , mask(InitialBuckets - 1)
+    , shift(32 - InitialBucketBits)
+    , size(0)
+    {
+
+    }
+
+    uint32 TransmogAppearanceIndex::GetBucket(uint32 itemGUID) const
+    {
+        // Item guids are mostly sequential, spread them with a fibonacci hash (the high bits of the product are the well mixed ones)
+        return (itemGUID * 2654435769U) >> shift;
+    }
+
+    const TransmogAppearance* TransmogAppearanceIndex::Find(uint32 itemGUID) const
+    {
+        if (itemGUID)
+        {
+            for (uint32 bucket = GetBucket(itemGUID);; bucket = (bucket + 1) & mask)
+            {
+                const TransmogAppearance& appearance = buckets[bucket];
+                if (appearance.itemGUID == itemGUID)
+                    return &appearance;
+
+                if (appearance.itemGUID == 0)
+                    return nullptr;
+            }
+        }
+
+        return nullptr;
+    }
+
+    uint32 TransmogAppearanceIndex::GetTransmogEntry(uint32 itemGUID) const
+    {
+        const TransmogAppearance* appearance = Find(itemGUID);
+        return appearance ? appearance->transmogEntry : 0;
+    }
+
+    void TransmogAppearanceIndex::Set(uint32 itemGUID, uint32 transmogEntry, uint32 playerID)
+    {
+        if (itemGUID == 0)
+            return;
+
+        // Keep the load factor below 50% so probe sequences stay short
+        if ((size + 1) * 2 > buckets.size())
+        {
+            Grow();
+        }
+
+        uint32 bucket = GetBucket(itemGUID);
+        while (buckets[bucket].itemGUID != 0 && buckets[bucket].itemGUID != itemGUID)
+        {
+            bucket = (bucket + 1) & mask;
+        }
+
+        TransmogAppearance& appearance = buckets[bucket];
+        if (appearance.itemGUID == 0)
+        {
+            size++;
+            playerItems[playerID].push_back(itemGUID);
+        }
+        else if (appearance.playerID != playerID)
+        {
+            RemovePlayerItem(appearance.playerID, itemGUID);
+            playerItems[playerID].push_back(itemGUID);
+        }
+
+        appearance = { itemGUID, transmogEntry, playerID };
+    }
+
+    bool TransmogAppearanceIndex::Erase(uint32 itemGUID)
+    {
+        if (itemGUID == 0)
+            return false;
+
+        uint32 bucket = GetBucket(itemGUID);
+        while (buckets[bucket].itemGUID != itemGUID)
+        {
+            if (buckets[bucket].itemGUID == 0)
+                return false;
+
+            bucket = (bucket + 1) & mask;
+        }
+
+        RemovePlayerItem(buckets[bucket].playerID, itemGUID);
+        size--;
+
+        // Backward shift deletion, moves the following entries of the cluster back so no tombstones are needed
+        uint32 hole = bucket;
+        for (uint32 next = (hole + 1) & mask; buckets[next].itemGUID != 0; next = (next + 1) & mask)
+        {
+            const uint32 home = GetBucket(buckets[next].itemGUID);
+            const bool canMove = hole <= next ? (home <= hole || home > next) : (home <= hole && home > next);
+            if (canMove)
+            {
+                buckets[hole] = buckets[next];
+                hole = next;
+            }
+        }
+
+        buckets[hole] = { 0, 0, 0 };
+        return true;
+    }
+
+    void TransmogAppearanceIndex::ErasePlayer(uint32 playerID)
+    {
+        auto it = playerItems.find(playerID);
+        if (it != playerItems.end())
+        {
+            // Erase works on a copy as it also updates the player item list
+            const std::vector<uint32> itemGUIDs = std::move(it->second);
+            playerItems.erase(it);
+
+            for (const uint32 itemGUID : itemGUIDs)
+            {
+                Erase(itemGUID);
+            }
+        }
+    }
+
+    const std::vector<uint32>* TransmogAppearanceIndex::GetPlayerItems(uint32 playerID) const
+    {
+        auto it = playerItems.find(playerID);
+        return it != playerItems.end() ? &it->second : nullptr;
+    }
+
+    void TransmogAppearanceIndex::Grow()
+    {
+        std::vector<TransmogAppearance> oldBuckets(buckets.size() * 2, { 0, 0, 0 });
+        oldBuckets.swap(buckets);
+        mask = buckets.size() - 1;
+        shift--;
+
+        for (const TransmogAppearance& appearance : oldBuckets)
+        {
+            if (appearance.itemGUID != 0)
+            {
+                uint32 bucket = GetBucket(appearance.itemGUID);
+                while (buckets[bucket].itemGUID != 0)
+                {
+                    bucket = (bucket + 1) & mask;
+                }
+
+                buckets[bucket] = appearance;
+            }
+        }
+    }
+
+    void TransmogAppearanceIndex::RemovePlayerItem(uint32 playerID, uint32 itemGUID)
+    {
+        auto it = playerItems.find(playerID);
+        if (it != playerItems.end())
+        {
+            std::vector<uint32>& itemGUIDs = it->second;
+            auto itemIt = std::find(itemGUIDs.begin(), itemGUIDs.end(), itemGUID);
+            if (itemIt != itemGUIDs.end())
+            {
+                *itemIt = itemGUIDs.back();
+                itemGUIDs.pop_back();
+            }
+
+            if (itemGUIDs.empty())
+            {
+                playerItems.erase(it);
+            }
+        }
+    }
+}
\ No newline at end of file
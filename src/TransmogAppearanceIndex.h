@@ -0,0 +1,51 @@
+#ifndef CMANGOS_MODULE_TRANSMOG_APPEARANCE_INDEX_H
+#define CMANGOS_MODULE_TRANSMOG_APPEARANCE_INDEX_H
+
+#include "Platform/Define.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace cmangos_module
+{
+    struct TransmogAppearance
+    {
+        uint32 itemGUID;
+        uint32 transmogEntry;
+        uint32 playerID;
+    };
+
+    // Open addressing (linear probing) index of the active transmogs keyed by item guid.
+    // A lookup resolves the transmog entry and its owner with a single probe sequence
+    // over a flat array, while the per player item lists keep the logout cleanup cheap.
+    class TransmogAppearanceIndex
+    {
+    public:
+        TransmogAppearanceIndex();
+
+        const TransmogAppearance* Find(uint32 itemGUID) const;
+        uint32 GetTransmogEntry(uint32 itemGUID) const;
+
+        void Set(uint32 itemGUID, uint32 transmogEntry, uint32 playerID);
+        bool Erase(uint32 itemGUID);
+        void ErasePlayer(uint32 playerID);
+
+        const std::vector<uint32>* GetPlayerItems(uint32 playerID) const;
+        size_t Size() const { return size; }
+
+    private:
+        uint32 GetBucket(uint32 itemGUID) const;
+        void Grow();
+        void RemovePlayerItem(uint32 playerID, uint32 itemGUID);
+
+    private:
+        // Item guid 0 marks an empty bucket
+        std::vector<TransmogAppearance> buckets;
+        uint32 mask;
+        uint32 shift;   // 32 - bits of the bucket count
+        size_t size;
+
+        std::unordered_map<uint32, std::vector<uint32>> playerItems;
+    };
+}
+#endif
\ No newline at end of file
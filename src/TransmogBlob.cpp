@@ -0,0 +1,111 @@
+#include "TransmogBlob.h"
+
+#include <algorithm>
+
+namespace cmangos_module
+{
+    static const char HexDigits[] = "0123456789ABCDEF";
+
+    static void WriteVarint(uint32 value, std::string& hex)
+    {
+        do
+        {
+            uint8 byte = value & 0x7F;
+            value >>= 7;
+            if (value)
+            {
+                byte |= 0x80;
+            }
+
+            hex += HexDigits[byte >> 4];
+            hex += HexDigits[byte & 0x0F];
+        }
+        while (value);
+    }
+
+    static int8 GetHexValue(char digit)
+    {
+        if (digit >= '0' && digit <= '9')
+            return digit - '0';
+
+        if (digit >= 'A' && digit <= 'F')
+            return digit - 'A' + 10;
+
+        if (digit >= 'a' && digit <= 'f')
+            return digit - 'a' + 10;
+
+        return -1;
+    }
+
+    static bool ReadVarint(const char*& hex, uint32& value)
+    {
+        value = 0;
+        for (uint8 shift = 0; shift < 35; shift += 7)
+        {
+            if (hex[0] == '\0' || hex[1] == '\0')
+                return false;
+
+            const int8 high = GetHexValue(hex[0]);
+            const int8 low = GetHexValue(hex[1]);
+            if (high < 0 || low < 0)
+                return false;
+
+            hex += 2;
+
+            const uint8 byte = (high << 4) | low;
+            value |= uint32(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+
+        return false;
+    }
+
+    void EncodeTransmogSegment(const std::vector<uint32>& itemEntries, std::string& hex)
+    {
+        WriteVarint(itemEntries.size(), hex);
+
+        uint32 previous = 0;
+        for (const uint32 itemEntry : itemEntries)
+        {
+            WriteVarint(itemEntry - previous, hex);
+            previous = itemEntry;
+        }
+    }
+
+    bool DecodeTransmogBlob(const char* hex, std::vector<uint32>& itemEntries)
+    {
+        if (!hex)
+            return false;
+
+        bool sorted = true;
+        while (*hex)
+        {
+            uint32 amount = 0;
+            if (!ReadVarint(hex, amount))
+                return false;
+
+            // Every segment is sorted but they need to be merged if there is more than one
+            sorted = sorted && itemEntries.empty();
+
+            uint32 itemEntry = 0;
+            for (uint32 i = 0; i < amount; ++i)
+            {
+                uint32 delta = 0;
+                if (!ReadVarint(hex, delta))
+                    return false;
+
+                itemEntry += delta;
+                itemEntries.push_back(itemEntry);
+            }
+        }
+
+        if (!sorted)
+        {
+            std::sort(itemEntries.begin(), itemEntries.end());
+            itemEntries.erase(std::unique(itemEntries.begin(), itemEntries.end()), itemEntries.end());
+        }
+
+        return true;
+    }
+}
\ No newline at end of file
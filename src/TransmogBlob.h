@@ -0,0 +1,25 @@
+#ifndef CMANGOS_MODULE_TRANSMOG_BLOB_H
+#define CMANGOS_MODULE_TRANSMOG_BLOB_H
+
+#include "Platform/Define.h"
+
+#include <string>
+#include <vector>
+
+namespace cmangos_module
+{
+    // Version of the custom_transmog_collection data format
+    constexpr uint8 TRANSMOG_BLOB_VERSION = 1;
+
+    // A collection blob is a list of segments, new discoveries are appended as a new segment
+    // and the blob is compacted back into a single segment from time to time. Each segment is
+    // a varint with the amount of entries followed by the sorted item entries as varint deltas.
+    // The data goes through the database as hexadecimal text so no byte can truncate it.
+
+    // Appends the hexadecimal encoding of a segment with the given (sorted, unique) item entries
+    void EncodeTransmogSegment(const std::vector<uint32>& itemEntries, std::string& hex);
+
+    // Decodes every segment of a blob in hexadecimal, the result is sorted and without duplicates
+    bool DecodeTransmogBlob(const char* hex, std::vector<uint32>& itemEntries);
+}
+#endif
\ No newline at end of file
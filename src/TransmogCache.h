@@ -0,0 +1,109 @@
+#ifndef CMANGOS_MODULE_TRANSMOG_CACHE_H
+#define CMANGOS_MODULE_TRANSMOG_CACHE_H
+
+#include <ctime>
+#include <list>
+#include <unordered_map>
+
+namespace cmangos_module
+{
+    // Bounded least recently used cache with a time to live per entry
+    template <typename Key, typename Value>
+    class TransmogLRUCache
+    {
+    public:
+        TransmogLRUCache() : maxEntries(0), ttl(0) {}
+
+        void SetLimits(size_t maxEntries, time_t ttl)
+        {
+            this->maxEntries = maxEntries;
+            this->ttl = ttl;
+
+            while (entries.size() > maxEntries)
+            {
+                index.erase(entries.back().key);
+                entries.pop_back();
+            }
+        }
+
+        bool IsEnabled() const { return maxEntries > 0 && ttl > 0; }
+
+        void Insert(const Key& key, Value&& value, time_t now)
+        {
+            if (!IsEnabled())
+                return;
+
+            Erase(key);
+
+            entries.push_front({ key, std::move(value), now + ttl });
+            index[key] = entries.begin();
+
+            if (entries.size() > maxEntries)
+            {
+                index.erase(entries.back().key);
+                entries.pop_back();
+            }
+        }
+
+        // Moves the entry out of the cache if it exists and has not expired
+        bool Take(const Key& key, Value& value, time_t now)
+        {
+            auto it = index.find(key);
+            if (it == index.end())
+                return false;
+
+            const bool expired = it->second->expireTime <= now;
+            if (!expired)
+            {
+                value = std::move(it->second->value);
+            }
+
+            entries.erase(it->second);
+            index.erase(it);
+            return !expired;
+        }
+
+        bool Contains(const Key& key) const
+        {
+            return index.find(key) != index.end();
+        }
+
+        void Erase(const Key& key)
+        {
+            auto it = index.find(key);
+            if (it != index.end())
+            {
+                entries.erase(it->second);
+                index.erase(it);
+            }
+        }
+
+        void RemoveExpired(time_t now)
+        {
+            // Every entry has the same time to live so the oldest ones are at the back
+            while (!entries.empty() && entries.back().expireTime <= now)
+            {
+                index.erase(entries.back().key);
+                entries.pop_back();
+            }
+        }
+
+        size_t Size() const { return entries.size(); }
+
+    private:
+        struct Entry
+        {
+            Key key;
+            Value value;
+            time_t expireTime;
+        };
+
+        size_t maxEntries;
+        time_t ttl;
+
+        // Most recently inserted first
+        std::list<Entry> entries;
+        std::unordered_map<Key, typename std::list<Entry>::iterator> index;
+    };
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,785 @@
+#include "TransmogCatalog.h"
+
+#include "Entities/Player.h"
+#include "Globals/ObjectMgr.h"
+#include "World/World.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <unordered_map>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSMOG_CATALOG_SSE2
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cmangos_module
+{
+    constexpr uint32 SubclassMask()
+    {
+        return 0U;
+    }
+
+    template <typename... Subclasses>
+    constexpr uint32 SubclassMask(uint32 subclass, Subclasses... subclasses)
+    {
+        return (1U << subclass) | SubclassMask(subclasses...);
+    }
+
+    struct TransmogClassMasks
+    {
+        uint32 weapons;
+        uint32 armor;
+    };
+
+    // Weapon and armor subclasses each class can use as a transmog, one bit per subclass
+    constexpr TransmogClassMasks GetClassMasks(uint8 playerClass)
+    {
+        switch (playerClass)
+        {
+            case CLASS_WARRIOR: return {
+                SubclassMask(ITEM_SUBCLASS_WEAPON_AXE, ITEM_SUBCLASS_WEAPON_AXE2, ITEM_SUBCLASS_WEAPON_BOW, ITEM_SUBCLASS_WEAPON_GUN, ITEM_SUBCLASS_WEAPON_MACE, ITEM_SUBCLASS_WEAPON_MACE2, ITEM_SUBCLASS_WEAPON_POLEARM, ITEM_SUBCLASS_WEAPON_SWORD, ITEM_SUBCLASS_WEAPON_SWORD2, ITEM_SUBCLASS_WEAPON_STAFF, ITEM_SUBCLASS_WEAPON_FIST, ITEM_SUBCLASS_WEAPON_DAGGER, ITEM_SUBCLASS_WEAPON_CROSSBOW),
+                SubclassMask(ITEM_SUBCLASS_ARMOR_CLOTH, ITEM_SUBCLASS_ARMOR_LEATHER, ITEM_SUBCLASS_ARMOR_MAIL, ITEM_SUBCLASS_ARMOR_PLATE, ITEM_SUBCLASS_ARMOR_SHIELD) };
+            case CLASS_PALADIN: return {
+                SubclassMask(ITEM_SUBCLASS_WEAPON_AXE, ITEM_SUBCLASS_WEAPON_AXE2, ITEM_SUBCLASS_WEAPON_MACE, ITEM_SUBCLASS_WEAPON_MACE2, ITEM_SUBCLASS_WEAPON_POLEARM, ITEM_SUBCLASS_WEAPON_SWORD, ITEM_SUBCLASS_WEAPON_SWORD2),
+                SubclassMask(ITEM_SUBCLASS_ARMOR_CLOTH, ITEM_SUBCLASS_ARMOR_LEATHER, ITEM_SUBCLASS_ARMOR_MAIL, ITEM_SUBCLASS_ARMOR_PLATE, ITEM_SUBCLASS_ARMOR_SHIELD) };
+            case CLASS_HUNTER: return {
+                SubclassMask(ITEM_SUBCLASS_WEAPON_AXE, ITEM_SUBCLASS_WEAPON_AXE2, ITEM_SUBCLASS_WEAPON_BOW, ITEM_SUBCLASS_WEAPON_GUN, ITEM_SUBCLASS_WEAPON_POLEARM, ITEM_SUBCLASS_WEAPON_SWORD, ITEM_SUBCLASS_WEAPON_SWORD2, ITEM_SUBCLASS_WEAPON_STAFF, ITEM_SUBCLASS_WEAPON_FIST, ITEM_SUBCLASS_WEAPON_DAGGER, ITEM_SUBCLASS_WEAPON_CROSSBOW),
+                SubclassMask(ITEM_SUBCLASS_ARMOR_CLOTH, ITEM_SUBCLASS_ARMOR_LEATHER, ITEM_SUBCLASS_ARMOR_MAIL) };
+            case CLASS_ROGUE: return {
+                SubclassMask(ITEM_SUBCLASS_WEAPON_AXE, ITEM_SUBCLASS_WEAPON_BOW, ITEM_SUBCLASS_WEAPON_GUN, ITEM_SUBCLASS_WEAPON_MACE, ITEM_SUBCLASS_WEAPON_SWORD, ITEM_SUBCLASS_WEAPON_FIST, ITEM_SUBCLASS_WEAPON_DAGGER, ITEM_SUBCLASS_WEAPON_CROSSBOW),
+                SubclassMask(ITEM_SUBCLASS_ARMOR_CLOTH, ITEM_SUBCLASS_ARMOR_LEATHER) };
+            case CLASS_PRIEST: return {
+                SubclassMask(ITEM_SUBCLASS_WEAPON_MACE, ITEM_SUBCLASS_WEAPON_STAFF, ITEM_SUBCLASS_WEAPON_DAGGER, ITEM_SUBCLASS_WEAPON_WAND),
+                SubclassMask(ITEM_SUBCLASS_ARMOR_CLOTH) };
+#if EXPANSION == 2
+            case CLASS_DEATH_KNIGHT: return {
+                SubclassMask(ITEM_SUBCLASS_WEAPON_AXE, ITEM_SUBCLASS_WEAPON_AXE2, ITEM_SUBCLASS_WEAPON_MACE, ITEM_SUBCLASS_WEAPON_MACE2, ITEM_SUBCLASS_WEAPON_POLEARM, ITEM_SUBCLASS_WEAPON_SWORD, ITEM_SUBCLASS_WEAPON_SWORD2),
+                SubclassMask(ITEM_SUBCLASS_ARMOR_CLOTH, ITEM_SUBCLASS_ARMOR_LEATHER, ITEM_SUBCLASS_ARMOR_MAIL, ITEM_SUBCLASS_ARMOR_PLATE) };
+#endif
+            case CLASS_SHAMAN: return {
+                SubclassMask(ITEM_SUBCLASS_WEAPON_AXE, ITEM_SUBCLASS_WEAPON_AXE2, ITEM_SUBCLASS_WEAPON_MACE, ITEM_SUBCLASS_WEAPON_MACE2, ITEM_SUBCLASS_WEAPON_STAFF, ITEM_SUBCLASS_WEAPON_FIST, ITEM_SUBCLASS_WEAPON_DAGGER),
+                SubclassMask(ITEM_SUBCLASS_ARMOR_CLOTH, ITEM_SUBCLASS_ARMOR_LEATHER, ITEM_SUBCLASS_ARMOR_MAIL) };
+            case CLASS_MAGE: return {
+                SubclassMask(ITEM_SUBCLASS_WEAPON_SWORD, ITEM_SUBCLASS_WEAPON_STAFF, ITEM_SUBCLASS_WEAPON_DAGGER, ITEM_SUBCLASS_WEAPON_WAND),
+                SubclassMask(ITEM_SUBCLASS_ARMOR_CLOTH) };
+            case CLASS_WARLOCK: return {
+                SubclassMask(ITEM_SUBCLASS_WEAPON_SWORD, ITEM_SUBCLASS_WEAPON_STAFF, ITEM_SUBCLASS_WEAPON_DAGGER, ITEM_SUBCLASS_WEAPON_WAND),
+                SubclassMask(ITEM_SUBCLASS_ARMOR_CLOTH) };
+            case CLASS_DRUID: return {
+                SubclassMask(ITEM_SUBCLASS_WEAPON_MACE, ITEM_SUBCLASS_WEAPON_POLEARM, ITEM_SUBCLASS_WEAPON_STAFF, ITEM_SUBCLASS_WEAPON_FIST, ITEM_SUBCLASS_WEAPON_DAGGER),
+                SubclassMask(ITEM_SUBCLASS_ARMOR_CLOTH, ITEM_SUBCLASS_ARMOR_LEATHER) };
+            default: return { 0U, 0U };
+        }
+    }
+
+    static_assert(ITEM_SUBCLASS_WEAPON_FISHING_POLE < 32 && ITEM_SUBCLASS_ARMOR_SHIELD < 32, "Transmog subclass masks need a bit per subclass");
+    static_assert(GetClassMasks(CLASS_PRIEST).armor == SubclassMask(ITEM_SUBCLASS_ARMOR_CLOTH), "Transmog class masks must be built at compile time");
+
+    // Equipment slots an item can use regardless of the player, like Player::ViableEquipSlots
+    static uint8 GetInventoryTypeSlots(const ItemPrototype* proto, uint8* slots, uint8& flags)
+    {
+        uint8 amount = 0;
+        switch (proto->InventoryType)
+        {
+            case INVTYPE_HEAD: slots[amount++] = EQUIPMENT_SLOT_HEAD; break;
+            case INVTYPE_NECK: slots[amount++] = EQUIPMENT_SLOT_NECK; break;
+            case INVTYPE_SHOULDERS: slots[amount++] = EQUIPMENT_SLOT_SHOULDERS; break;
+            case INVTYPE_BODY: slots[amount++] = EQUIPMENT_SLOT_BODY; break;
+            case INVTYPE_CHEST:
+            case INVTYPE_ROBE: slots[amount++] = EQUIPMENT_SLOT_CHEST; break;
+            case INVTYPE_WAIST: slots[amount++] = EQUIPMENT_SLOT_WAIST; break;
+            case INVTYPE_LEGS: slots[amount++] = EQUIPMENT_SLOT_LEGS; break;
+            case INVTYPE_FEET: slots[amount++] = EQUIPMENT_SLOT_FEET; break;
+            case INVTYPE_WRISTS: slots[amount++] = EQUIPMENT_SLOT_WRISTS; break;
+            case INVTYPE_HANDS: slots[amount++] = EQUIPMENT_SLOT_HANDS; break;
+            case INVTYPE_CLOAK: slots[amount++] = EQUIPMENT_SLOT_BACK; break;
+            case INVTYPE_TABARD: slots[amount++] = EQUIPMENT_SLOT_TABARD; break;
+            case INVTYPE_FINGER:
+            {
+                slots[amount++] = EQUIPMENT_SLOT_FINGER1;
+                slots[amount++] = EQUIPMENT_SLOT_FINGER2;
+                break;
+            }
+            case INVTYPE_TRINKET:
+            {
+                slots[amount++] = EQUIPMENT_SLOT_TRINKET1;
+                slots[amount++] = EQUIPMENT_SLOT_TRINKET2;
+                break;
+            }
+            case INVTYPE_WEAPON:
+            {
+                slots[amount++] = EQUIPMENT_SLOT_MAINHAND;
+                flags |= TRANSMOG_CATALOG_FLAG_DUAL_WIELD;
+                break;
+            }
+            case INVTYPE_2HWEAPON:
+            {
+                slots[amount++] = EQUIPMENT_SLOT_MAINHAND;
+#if EXPANSION == 2
+                if (proto->SubClass == ITEM_SUBCLASS_WEAPON_AXE2 || proto->SubClass == ITEM_SUBCLASS_WEAPON_MACE2 || proto->SubClass == ITEM_SUBCLASS_WEAPON_SWORD2)
+                {
+                    flags |= TRANSMOG_CATALOG_FLAG_TITAN_GRIP;
+                }
+#endif
+                break;
+            }
+            case INVTYPE_WEAPONMAINHAND: slots[amount++] = EQUIPMENT_SLOT_MAINHAND; break;
+            case INVTYPE_WEAPONOFFHAND:
+            case INVTYPE_SHIELD:
+            case INVTYPE_HOLDABLE: slots[amount++] = EQUIPMENT_SLOT_OFFHAND; break;
+            case INVTYPE_RANGED:
+            case INVTYPE_THROWN:
+            case INVTYPE_RANGEDRIGHT: slots[amount++] = EQUIPMENT_SLOT_RANGED; break;
+            default: break;
+        }
+
+        return amount;
+    }
+
+    // Classes which can use the given subclass as a transmog
+    static uint32 GetSubclassClassMask(uint8 itemClass, uint8 itemSubclass)
+    {
+        uint32 classMask = 0;
+        if (itemSubclass < 32)
+        {
+            for (uint8 playerClass = CLASS_WARRIOR; playerClass < MAX_CLASSES; ++playerClass)
+            {
+                const TransmogClassMasks classMasks = GetClassMasks(playerClass);
+                const uint32 subclassMask = itemClass == ITEM_CLASS_WEAPON ? classMasks.weapons : classMasks.armor;
+                if (subclassMask & (1U << itemSubclass))
+                {
+                    classMask |= 1U << (playerClass - 1);
+                }
+            }
+        }
+
+        return classMask;
+    }
+
+    static void BuildCatalogRange(uint32 firstEntry, uint32 lastEntry, std::vector<TransmogCatalogEntry>& entries)
+    {
+        for (uint32 itemEntry = firstEntry; itemEntry < lastEntry; ++itemEntry)
+        {
+            const ItemPrototype* proto = sItemStorage.LookupEntry<ItemPrototype>(itemEntry);
+            if (!proto || (proto->Class != ITEM_CLASS_WEAPON && proto->Class != ITEM_CLASS_ARMOR))
+                continue;
+
+            TransmogCatalogEntry entry;
+            entry.itemID = proto->ItemId;
+            entry.displayID = proto->DisplayInfoID;
+            entry.displayGroup = 0;
+            entry.classMask = uint32(proto->AllowableClass) & GetSubclassClassMask(proto->Class, proto->SubClass);
+            entry.raceMask = uint32(proto->AllowableRace);
+            entry.itemClass = proto->Class;
+            entry.itemSubclass = proto->SubClass;
+            entry.inventoryType = proto->InventoryType;
+            entry.flags = 0;
+            std::fill(std::begin(entry.slots), std::end(entry.slots), NULL_SLOT);
+            entry.quality = proto->Quality;
+            std::fill(std::begin(entry.padding), std::end(entry.padding), 0);
+
+            if (entry.classMask && entry.raceMask && GetInventoryTypeSlots(proto, entry.slots, entry.flags) > 0)
+            {
+                entries.push_back(entry);
+            }
+        }
+    }
+
+    constexpr char CatalogFileMagic[8] = { 'T', 'M', 'O', 'G', 'C', 'A', 'T', '\0' };
+    constexpr uint32 CatalogFileVersion = 2;
+
+    struct TransmogCatalogFileHeader
+    {
+        char magic[8];
+        uint32 version;
+        uint32 expansion;
+        uint64 checksum;
+        uint32 entrySize;
+        uint32 entriesCount;
+        uint32 entryIndexSize;
+        uint32 displayGroupsCount;
+    };
+
+    static_assert(sizeof(TransmogCatalogFileHeader) % sizeof(uint64) == 0, "The catalog data must stay aligned after the file header");
+    static_assert(sizeof(TransmogCatalogEntry) % sizeof(uint32) == 0, "The catalog indexes must stay aligned after the entries");
+
+    static void FillHeader(TransmogCatalogFileHeader& header, uint32 entriesCount, uint32 entryIndexSize, uint32 displayGroupsCount, uint64 checksum)
+    {
+        memcpy(header.magic, CatalogFileMagic, sizeof(header.magic));
+        header.version = CatalogFileVersion;
+        header.expansion = EXPANSION;
+        header.checksum = checksum;
+        header.entrySize = sizeof(TransmogCatalogEntry);
+        header.entriesCount = entriesCount;
+        header.entryIndexSize = entryIndexSize;
+        header.displayGroupsCount = displayGroupsCount;
+    }
+
+    static size_t GetCatalogFileSize(const TransmogCatalogFileHeader& header)
+    {
+        return sizeof(TransmogCatalogFileHeader) +
+               size_t(header.entriesCount) * sizeof(TransmogCatalogEntry) +
+               size_t(header.entryIndexSize) * sizeof(uint32) +
+               (size_t(header.displayGroupsCount) + 1) * sizeof(uint32) +
+               size_t(header.entriesCount) * sizeof(uint32);
+    }
+
+    static bool IsCompatibleHeader(const uint8* data, const TransmogCatalogFileHeader& expected)
+    {
+        TransmogCatalogFileHeader header;
+        memcpy(&header, data, sizeof(header));
+        return memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 &&
+               header.version == expected.version &&
+               header.expansion == expected.expansion &&
+               header.checksum == expected.checksum &&
+               header.entrySize == expected.entrySize;
+    }
+
+    TransmogCatalog::TransmogCatalog()
+    : entries(nullptr)
+    , entriesCount(0)
+    , entryIndex(nullptr)
+    , entryIndexSize(0)
+    , displayGroupOffsets(nullptr)
+    , displayGroupItems(nullptr)
+    , displayGroupsCount(0)
+    , mapping(nullptr)
+    , mappingSize(0)
+    {
+
+    }
+
+    TransmogCatalog::~TransmogCatalog()
+    {
+        Release();
+    }
+
+    void TransmogCatalog::Build(uint32 threads)
+    {
+        const uint32 maxEntry = sItemStorage.GetMaxEntry();
+        if (threads == 0)
+        {
+            threads = std::max(1U, std::thread::hardware_concurrency());
+        }
+
+        // Every worker scans its own range of entries so the results only need to be appended in order
+        const uint32 rangeSize = (maxEntry + threads - 1) / threads;
+        std::vector<std::vector<TransmogCatalogEntry>> results(threads);
+        std::vector<std::thread> workers;
+        for (uint32 i = 1; i < threads; ++i)
+        {
+            const uint32 firstEntry = std::min(maxEntry, i * rangeSize);
+            const uint32 lastEntry = std::min(maxEntry, firstEntry + rangeSize);
+            workers.emplace_back(BuildCatalogRange, firstEntry, lastEntry, std::ref(results[i]));
+        }
+
+        BuildCatalogRange(1, std::min(maxEntry, rangeSize), results[0]);
+
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+
+        std::vector<TransmogCatalogEntry> builtEntries;
+        for (std::vector<TransmogCatalogEntry>& result : results)
+        {
+            builtEntries.insert(builtEntries.end(), result.begin(), result.end());
+        }
+
+        // Assign the display groups in item id order and index the entries
+        std::unordered_map<uint32, uint32> displayGroups;
+        std::vector<uint32> displayGroupSizes;
+        std::vector<uint32> builtEntryIndex(maxEntry, 0);
+        for (uint32 i = 0; i < builtEntries.size(); ++i)
+        {
+            TransmogCatalogEntry& entry = builtEntries[i];
+            auto it = displayGroups.emplace(entry.displayID, displayGroups.size()).first;
+            entry.displayGroup = it->second;
+            if (entry.displayGroup == displayGroupSizes.size())
+            {
+                displayGroupSizes.push_back(0);
+            }
+
+            displayGroupSizes[entry.displayGroup]++;
+            builtEntryIndex[entry.itemID] = i + 1;
+        }
+
+        std::vector<uint32> builtDisplayGroupOffsets(displayGroupSizes.size() + 1, 0);
+        for (uint32 group = 0; group < displayGroupSizes.size(); ++group)
+        {
+            builtDisplayGroupOffsets[group + 1] = builtDisplayGroupOffsets[group] + displayGroupSizes[group];
+        }
+
+        std::vector<uint32> builtDisplayGroupItems(builtEntries.size());
+        std::vector<uint32> displayGroupFill(builtDisplayGroupOffsets.begin(), builtDisplayGroupOffsets.end() - 1);
+        for (uint32 i = 0; i < builtEntries.size(); ++i)
+        {
+            builtDisplayGroupItems[displayGroupFill[builtEntries[i].displayGroup]++] = i;
+        }
+
+        Assemble(builtEntries, builtEntryIndex, builtDisplayGroupOffsets, builtDisplayGroupItems);
+    }
+
+    void TransmogCatalog::Assemble(const std::vector<TransmogCatalogEntry>& builtEntries, const std::vector<uint32>& builtEntryIndex, const std::vector<uint32>& builtDisplayGroupOffsets, const std::vector<uint32>& builtDisplayGroupItems)
+    {
+        TransmogCatalogFileHeader header;
+        FillHeader(header, builtEntries.size(), builtEntryIndex.size(), builtDisplayGroupOffsets.size() - 1, 0);
+
+        const size_t size = GetCatalogFileSize(header);
+        std::vector<uint64> data((size + sizeof(uint64) - 1) / sizeof(uint64));
+        uint8* out = reinterpret_cast<uint8*>(data.data());
+
+        memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+        memcpy(out, builtEntries.data(), builtEntries.size() * sizeof(TransmogCatalogEntry));
+        out += builtEntries.size() * sizeof(TransmogCatalogEntry);
+        memcpy(out, builtEntryIndex.data(), builtEntryIndex.size() * sizeof(uint32));
+        out += builtEntryIndex.size() * sizeof(uint32);
+        memcpy(out, builtDisplayGroupOffsets.data(), builtDisplayGroupOffsets.size() * sizeof(uint32));
+        out += builtDisplayGroupOffsets.size() * sizeof(uint32);
+        memcpy(out, builtDisplayGroupItems.data(), builtDisplayGroupItems.size() * sizeof(uint32));
+
+        Release();
+        buffer = std::move(data);
+        SetData(reinterpret_cast<const uint8*>(buffer.data()), size);
+    }
+
+    bool TransmogCatalog::SetData(const uint8* data, size_t size)
+    {
+        if (size < sizeof(TransmogCatalogFileHeader))
+            return false;
+
+        TransmogCatalogFileHeader header;
+        memcpy(&header, data, sizeof(header));
+        if (GetCatalogFileSize(header) != size)
+            return false;
+
+        const TransmogCatalogEntry* dataEntries = reinterpret_cast<const TransmogCatalogEntry*>(data + sizeof(header));
+        const uint32* dataEntryIndex = reinterpret_cast<const uint32*>(dataEntries + header.entriesCount);
+        const uint32* dataDisplayGroupOffsets = dataEntryIndex + header.entryIndexSize;
+        const uint32* dataDisplayGroupItems = dataDisplayGroupOffsets + header.displayGroupsCount + 1;
+
+        // Make sure a damaged file can't point outside of the catalog
+        for (uint32 i = 0; i < header.entriesCount; ++i)
+        {
+            if (dataEntries[i].displayGroup >= header.displayGroupsCount || dataDisplayGroupItems[i] >= header.entriesCount)
+                return false;
+        }
+
+        for (uint32 i = 0; i < header.entryIndexSize; ++i)
+        {
+            if (dataEntryIndex[i] > header.entriesCount)
+                return false;
+        }
+
+        for (uint32 group = 0; group < header.displayGroupsCount; ++group)
+        {
+            if (dataDisplayGroupOffsets[group] > dataDisplayGroupOffsets[group + 1])
+                return false;
+        }
+
+        if (dataDisplayGroupOffsets[0] != 0 || dataDisplayGroupOffsets[header.displayGroupsCount] != header.entriesCount)
+            return false;
+
+        entries = dataEntries;
+        entriesCount = header.entriesCount;
+        entryIndex = dataEntryIndex;
+        entryIndexSize = header.entryIndexSize;
+        displayGroupOffsets = dataDisplayGroupOffsets;
+        displayGroupItems = dataDisplayGroupItems;
+        displayGroupsCount = header.displayGroupsCount;
+
+        BuildColumns();
+        return true;
+    }
+
+    void TransmogCatalog::BuildColumns()
+    {
+        itemClasses.resize(entriesCount);
+        itemSubclasses.resize(entriesCount);
+        slotMasks.resize(entriesCount);
+        entryFlags.resize(entriesCount);
+        filters.clear();
+
+        for (uint32 i = 0; i < entriesCount; ++i)
+        {
+            const TransmogCatalogEntry& entry = entries[i];
+            itemClasses[i] = entry.itemClass;
+            itemSubclasses[i] = entry.itemSubclass;
+            slotMasks[i] = GetSlotMask(entry, 0);
+            entryFlags[i] = entry.flags;
+        }
+    }
+
+    bool TransmogCatalog::LoadFile(const std::string& path, uint64 checksum)
+    {
+        if (path.empty())
+            return false;
+
+        TransmogCatalogFileHeader expected;
+        FillHeader(expected, 0, 0, 0, checksum);
+
+#ifdef _WIN32
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+            return false;
+
+        const size_t size = (size_t)file.tellg();
+        if (size < sizeof(TransmogCatalogFileHeader))
+            return false;
+
+        std::vector<uint64> data((size + sizeof(uint64) - 1) / sizeof(uint64));
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char*>(data.data()), size) || !IsCompatibleHeader(reinterpret_cast<const uint8*>(data.data()), expected))
+            return false;
+
+        Release();
+        buffer = std::move(data);
+        if (!SetData(reinterpret_cast<const uint8*>(buffer.data()), size))
+        {
+            Release();
+            return false;
+        }
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(TransmogCatalogFileHeader))
+        {
+            close(fd);
+            return false;
+        }
+
+        const size_t size = (size_t)fileStat.st_size;
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (data == MAP_FAILED)
+            return false;
+
+        if (!IsCompatibleHeader(static_cast<const uint8*>(data), expected))
+        {
+            munmap(data, size);
+            return false;
+        }
+
+        Release();
+        mapping = data;
+        mappingSize = size;
+        if (!SetData(static_cast<const uint8*>(data), size))
+        {
+            Release();
+            return false;
+        }
+#endif
+
+        return true;
+    }
+
+    bool TransmogCatalog::SaveFile(const std::string& path, uint64 checksum) const
+    {
+        if (path.empty() || !entries)
+            return false;
+
+        TransmogCatalogFileHeader header;
+        FillHeader(header, entriesCount, entryIndexSize, displayGroupsCount, checksum);
+
+        // Write to a temporary file first so other processes never map a partially written catalog
+        const std::string tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file)
+                return false;
+
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(entries), GetCatalogFileSize(header) - sizeof(header));
+            if (!file)
+            {
+                file.close();
+                std::remove(tempPath.c_str());
+                return false;
+            }
+        }
+
+#ifdef _WIN32
+        std::remove(path.c_str());
+#endif
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    uint64 TransmogCatalog::CalculateChecksum()
+    {
+        // FNV-1a over the world database version and the item template fields the catalog is derived from
+        uint64 checksum = 14695981039346656037ULL;
+        auto Hash = [&checksum](uint8 value)
+        {
+            checksum ^= value;
+            checksum *= 1099511628211ULL;
+        };
+
+        auto HashNumber = [&Hash](uint32 value)
+        {
+            for (uint8 i = 0; i < sizeof(value); ++i)
+            {
+                Hash((value >> (i * 8)) & 0xFF);
+            }
+        };
+
+        for (const char* version = sWorld.GetDBVersion(); *version; ++version)
+        {
+            Hash(uint8(*version));
+        }
+
+        const uint32 maxEntry = sItemStorage.GetMaxEntry();
+        HashNumber(sItemStorage.GetRecordCount());
+        HashNumber(maxEntry);
+
+        for (uint32 itemEntry = 1; itemEntry < maxEntry; ++itemEntry)
+        {
+            const ItemPrototype* proto = sItemStorage.LookupEntry<ItemPrototype>(itemEntry);
+            if (!proto || (proto->Class != ITEM_CLASS_WEAPON && proto->Class != ITEM_CLASS_ARMOR))
+                continue;
+
+            HashNumber(proto->ItemId);
+            HashNumber(proto->Class);
+            HashNumber(proto->SubClass);
+            HashNumber(proto->DisplayInfoID);
+            HashNumber(proto->InventoryType);
+            HashNumber(proto->Quality);
+            HashNumber(uint32(proto->AllowableClass));
+            HashNumber(uint32(proto->AllowableRace));
+        }
+
+        return checksum;
+    }
+
+    bool TransmogCatalog::ReadFileChecksum(const std::string& path, uint64& checksum)
+    {
+        std::ifstream file(path, std::ios::binary);
+        TransmogCatalogFileHeader header;
+        if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            return false;
+
+        checksum = header.checksum;
+        return true;
+    }
+
+    void TransmogCatalog::Release()
+    {
+#ifndef _WIN32
+        if (mapping)
+        {
+            munmap(mapping, mappingSize);
+        }
+#endif
+
+        mapping = nullptr;
+        mappingSize = 0;
+        buffer.clear();
+        buffer.shrink_to_fit();
+
+        itemClasses.clear();
+        itemSubclasses.clear();
+        slotMasks.clear();
+        entryFlags.clear();
+        filters.clear();
+
+        entries = nullptr;
+        entriesCount = 0;
+        entryIndex = nullptr;
+        entryIndexSize = 0;
+        displayGroupOffsets = nullptr;
+        displayGroupItems = nullptr;
+        displayGroupsCount = 0;
+    }
+
+    bool TransmogCatalog::CanUse(const TransmogCatalogEntry& entry, const Player* player) const
+    {
+        return (entry.classMask & player->getClassMask()) != 0 && (entry.raceMask & player->getRaceMask()) != 0;
+    }
+
+    uint8 TransmogCatalog::GetPlayerFlags(const Player* player) const
+    {
+        uint8 playerFlags = 0;
+        if (player->CanDualWield())
+        {
+            playerFlags |= TRANSMOG_CATALOG_FLAG_DUAL_WIELD;
+        }
+
+#if EXPANSION == 2
+        if (player->CanTitanGrip())
+        {
+            playerFlags |= TRANSMOG_CATALOG_FLAG_TITAN_GRIP;
+        }
+#endif
+
+        return playerFlags;
+    }
+
+    uint32 TransmogCatalog::GetSlotMask(const TransmogCatalogEntry& entry, uint8 playerFlags) const
+    {
+        uint32 slotMask = 0;
+        for (uint8 slot : entry.slots)
+        {
+            if (slot != NULL_SLOT)
+            {
+                slotMask |= 1U << slot;
+            }
+        }
+
+        if (entry.flags & playerFlags)
+        {
+            slotMask |= 1U << EQUIPMENT_SLOT_OFFHAND;
+        }
+
+        return slotMask;
+    }
+
+    const std::vector<uint64>& TransmogCatalog::GetFilter(int8 slot, int8 itemClass, int8 itemSubclass, uint8 playerFlags) const
+    {
+        const uint32 key = uint8(slot) | (uint8(itemClass) << 8) | (uint8(itemSubclass) << 16) | (uint32(playerFlags) << 24);
+        auto it = filters.find(key);
+        if (it == filters.end())
+        {
+            // Only a few combinations are really used, drop them all if something goes wrong
+            if (filters.size() >= 512)
+            {
+                filters.clear();
+            }
+
+            it = filters.emplace(key, std::vector<uint64>()).first;
+            BuildFilter(slot, itemClass, itemSubclass, playerFlags, it->second);
+        }
+
+        return it->second;
+    }
+
+    void TransmogCatalog::BuildFilter(int8 slot, int8 itemClass, int8 itemSubclass, uint8 playerFlags, std::vector<uint64>& filter) const
+    {
+        filter.assign((entriesCount + 63) / 64, 0);
+
+        // Every entry has at least one slot, so no slot filter means every slot bit. The off hand
+        // also accepts the entries that can be moved there with the player capabilities.
+        const uint32 slotBits = slot >= 0 && slot < 32 ? 1U << slot : 0xFFFFFFFFU;
+        const uint32 flagBits = slot == EQUIPMENT_SLOT_OFFHAND ? playerFlags : 0U;
+        uint32 i = 0;
+
+#if defined(__AVX2__)
+        const __m256i classValue = _mm256_set1_epi8((char)itemClass);
+        const __m256i subclassValue = _mm256_set1_epi8((char)itemSubclass);
+        const __m256i slotValue = _mm256_set1_epi32((int)slotBits);
+        const __m256i flagValue = _mm256_set1_epi32((int)flagBits);
+        const __m256i zero = _mm256_setzero_si256();
+        for (; i + 32 <= entriesCount; i += 32)
+        {
+            uint32 selectedMask = 0xFFFFFFFFU;
+            if (itemClass >= 0)
+            {
+                const __m256i classes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&itemClasses[i]));
+                selectedMask &= (uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(classes, classValue));
+            }
+
+            if (itemSubclass >= 0)
+            {
+                const __m256i subclasses = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&itemSubclasses[i]));
+                selectedMask &= (uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(subclasses, subclassValue));
+            }
+
+            uint32 emptySlotMask = 0;
+            for (uint32 j = 0; j < 4; ++j)
+            {
+                const __m256i masks = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&slotMasks[i + j * 8]));
+                const __m256i flags = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&entryFlags[i + j * 8]));
+                const __m256i emptySlot = _mm256_cmpeq_epi32(_mm256_and_si256(masks, slotValue), zero);
+                const __m256i emptyFlag = _mm256_cmpeq_epi32(_mm256_and_si256(flags, flagValue), zero);
+                emptySlotMask |= (uint32)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(emptySlot, emptyFlag))) << (j * 8);
+            }
+
+            filter[i >> 6] |= uint64(selectedMask & ~emptySlotMask) << (i & 63);
+        }
+#elif defined(TRANSMOG_CATALOG_SSE2)
+        const __m128i classValue = _mm_set1_epi8((char)itemClass);
+        const __m128i subclassValue = _mm_set1_epi8((char)itemSubclass);
+        const __m128i slotValue = _mm_set1_epi32((int)slotBits);
+        const __m128i flagValue = _mm_set1_epi32((int)flagBits);
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= entriesCount; i += 16)
+        {
+            uint32 selectedMask = 0xFFFFU;
+            if (itemClass >= 0)
+            {
+                const __m128i classes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&itemClasses[i]));
+                selectedMask &= (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(classes, classValue));
+            }
+
+            if (itemSubclass >= 0)
+            {
+                const __m128i subclasses = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&itemSubclasses[i]));
+                selectedMask &= (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(subclasses, subclassValue));
+            }
+
+            uint32 emptySlotMask = 0;
+            for (uint32 j = 0; j < 4; ++j)
+            {
+                const __m128i masks = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&slotMasks[i + j * 4]));
+                const __m128i flags = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&entryFlags[i + j * 4]));
+                const __m128i emptySlot = _mm_cmpeq_epi32(_mm_and_si128(masks, slotValue), zero);
+                const __m128i emptyFlag = _mm_cmpeq_epi32(_mm_and_si128(flags, flagValue), zero);
+                emptySlotMask |= (uint32)_mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(emptySlot, emptyFlag))) << (j * 4);
+            }
+
+            filter[i >> 6] |= uint64(selectedMask & ~emptySlotMask) << (i & 63);
+        }
+#endif
+
+        // Scalar tail, or the whole catalog without SIMD support
+        for (; i < entriesCount; ++i)
+        {
+            if (itemClass >= 0 && itemClasses[i] != (uint8)itemClass)
+                continue;
+
+            if (itemSubclass >= 0 && itemSubclasses[i] != (uint8)itemSubclass)
+                continue;
+
+            if ((slotMasks[i] & slotBits) == 0 && (entryFlags[i] & flagBits) == 0)
+                continue;
+
+            filter[i >> 6] |= uint64(1) << (i & 63);
+        }
+    }
+
+    const uint32* TransmogCatalog::GetDisplayGroupItems(uint32 displayGroup, uint32& amount) const
+    {
+        if (displayGroup >= displayGroupsCount)
+        {
+            amount = 0;
+            return nullptr;
+        }
+
+        amount = displayGroupOffsets[displayGroup + 1] - displayGroupOffsets[displayGroup];
+        return &displayGroupItems[displayGroupOffsets[displayGroup]];
+    }
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#ifndef CMANGOS_MODULE_TRANSMOG_CATALOG_H
+#define CMANGOS_MODULE_TRANSMOG_CATALOG_H
+
+#include "Platform/Define.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Player;
+
+namespace cmangos_module
+{
+    enum TransmogCatalogFlags : uint8
+    {
+        TRANSMOG_CATALOG_FLAG_DUAL_WIELD = 0x01, // Can also go in the off hand if the player can dual wield
+        TRANSMOG_CATALOG_FLAG_TITAN_GRIP = 0x02, // Can also go in the off hand if the player has titan grip
+    };
+
+    struct TransmogCatalogEntry
+    {
+        uint32 itemID;
+        uint32 displayID;
+        uint32 displayGroup;
+        uint32 classMask;   // Classes allowed by the item which can also use its subclass
+        uint32 raceMask;
+        uint8 itemClass;
+        uint8 itemSubclass;
+        uint8 inventoryType;
+        uint8 flags;
+        uint8 slots[4];     // Slots available to every player, padded with NULL_SLOT
+        uint8 quality;
+        uint8 padding[3];   // Zeroed so the catalog file is always written the same way
+    };
+
+    // Immutable list of every weapon and armor that can be used as a transmog, built once
+    // from the item templates so the per player checks don't need to go through the prototypes.
+    // The data is kept in a single block with the same layout as the catalog file, which lets
+    // a file written by a previous start be mapped and used in place.
+    class TransmogCatalog
+    {
+    public:
+        TransmogCatalog();
+        ~TransmogCatalog();
+
+        TransmogCatalog(const TransmogCatalog&) = delete;
+        TransmogCatalog& operator=(const TransmogCatalog&) = delete;
+
+        // Scans the item templates split across the given amount of worker threads (0 = hardware threads)
+        void Build(uint32 threads);
+
+        // Maps a catalog file if it was built from the same item templates and expansion
+        bool LoadFile(const std::string& path, uint64 checksum);
+        bool SaveFile(const std::string& path, uint64 checksum) const;
+
+        // Key of the item templates the catalog is derived from (world database version and the fields of every
+        // weapon and armor template). A single pass over the templates, far cheaper than building the catalog.
+        static uint64 CalculateChecksum();
+
+        // Checksum a catalog file was saved with, lets the tools map it without the item templates
+        static bool ReadFileChecksum(const std::string& path, uint64& checksum);
+
+        const TransmogCatalogEntry* Find(uint32 itemEntry) const
+        {
+            const uint32 index = itemEntry < entryIndexSize ? entryIndex[itemEntry] : 0;
+            return index ? &entries[index - 1] : nullptr;
+        }
+
+        bool CanUse(const TransmogCatalogEntry& entry, const Player* player) const;
+
+        // Off hand capabilities of the player (TransmogCatalogFlags) and the equipment slots (one bit per slot) it allows
+        uint8 GetPlayerFlags(const Player* player) const;
+        uint32 GetSlotMask(const TransmogCatalogEntry& entry, uint8 playerFlags) const;
+
+        // Bitmap of the catalog positions that match the filters (a negative filter matches everything)
+        const std::vector<uint64>& GetFilter(int8 slot, int8 itemClass, int8 itemSubclass, uint8 playerFlags) const;
+
+        // Catalog entries sharing the same display id
+        const uint32* GetDisplayGroupItems(uint32 displayGroup, uint32& amount) const;
+
+        size_t Size() const { return entriesCount; }
+        uint32 GetDisplayGroupsCount() const { return displayGroupsCount; }
+        const TransmogCatalogEntry& GetEntry(uint32 index) const { return entries[index]; }
+        uint32 GetIndex(const TransmogCatalogEntry& entry) const { return &entry - entries; }
+        bool IsMapped() const { return mapping != nullptr; }
+
+    private:
+        void Assemble(const std::vector<TransmogCatalogEntry>& builtEntries, const std::vector<uint32>& builtEntryIndex, const std::vector<uint32>& builtDisplayGroupOffsets, const std::vector<uint32>& builtDisplayGroupItems);
+        bool SetData(const uint8* data, size_t size);
+        void BuildColumns();
+        void BuildFilter(int8 slot, int8 itemClass, int8 itemSubclass, uint8 playerFlags, std::vector<uint64>& filter) const;
+        void Release();
+
+    private:
+        // Sorted by item id
+        const TransmogCatalogEntry* entries;
+        uint32 entriesCount;
+
+        // Item id -> position in entries + 1, 0 if the item is not in the catalog
+        const uint32* entryIndex;
+        uint32 entryIndexSize;
+
+        // Entries grouped by display id, the items of a group are in [offsets[group], offsets[group + 1])
+        const uint32* displayGroupOffsets;
+        const uint32* displayGroupItems;
+        uint32 displayGroupsCount;
+
+        // Columns of the entries used by the filters
+        std::vector<uint8> itemClasses;
+        std::vector<uint8> itemSubclasses;
+        std::vector<uint32> slotMasks;
+        std::vector<uint32> entryFlags;
+
+        // The catalog never changes so the filters are built once per combination
+        mutable std::unordered_map<uint32, std::vector<uint64>> filters;
+
+        // Either a catalog built on this start or a mapped catalog file
+        std::vector<uint64> buffer;
+        void* mapping;
+        size_t mappingSize;
+    };
+}
+#endif
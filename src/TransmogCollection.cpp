@@ -0,0 +1,189 @@
+#include "TransmogCollection.h"
+
+#include <algorithm>
+
+namespace cmangos_module
+{
+    // Same as roaring bitmaps, an array of 4096 values uses as much memory as the bitmap
+    constexpr uint32 MaxArrayContainerSize = 4096;
+    constexpr uint32 BitmapContainerWords = 65536 / 64;
+
+    // Older positions are forgotten past this size, a client that far behind gets everything again
+    constexpr uint32 MaxHistorySize = 4096;
+
+    uint32 TransmogCollection::GetLowestBit(uint64 bits)
+    {
+        // De Bruijn multiplication, isolates the lowest bit and maps it to its position
+        static const uint8 positions[64] =
+        {
+            0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+            62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+            63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+            46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6
+        };
+
+        return positions[((bits & (~bits + 1)) * 0x03F79D71B4CB0A89ULL) >> 58];
+    }
+
+    const TransmogCollection::Container* TransmogCollection::FindContainer(uint16 key) const
+    {
+        auto it = std::lower_bound(containers.begin(), containers.end(), key, [](const Container& container, uint16 key)
+        {
+            return container.key < key;
+        });
+
+        return it != containers.end() && it->key == key ? &(*it) : nullptr;
+    }
+
+    bool TransmogCollection::Contains(uint32 index) const
+    {
+        if (const Container* container = FindContainer(index >> 16))
+        {
+            const uint16 value = index & 0xFFFF;
+            if (container->bitmap.empty())
+            {
+                return std::binary_search(container->values.begin(), container->values.end(), value);
+            }
+
+            return (container->bitmap[value >> 6] >> (value & 63)) & 1;
+        }
+
+        return false;
+    }
+
+    bool TransmogCollection::Add(uint32 index)
+    {
+        const uint16 key = index >> 16;
+        const uint16 value = index & 0xFFFF;
+
+        auto it = std::lower_bound(containers.begin(), containers.end(), key, [](const Container& container, uint16 key)
+        {
+            return container.key < key;
+        });
+
+        if (it == containers.end() || it->key != key)
+        {
+            it = containers.insert(it, Container());
+            it->key = key;
+        }
+
+        Container& container = *it;
+        if (container.bitmap.empty())
+        {
+            auto valueIt = std::lower_bound(container.values.begin(), container.values.end(), value);
+            if (valueIt != container.values.end() && *valueIt == value)
+                return false;
+
+            container.values.insert(valueIt, value);
+
+            // Switch to a bitmap once the array gets bigger than it
+            if (container.values.size() > MaxArrayContainerSize)
+            {
+                container.bitmap.assign(BitmapContainerWords, 0);
+                for (const uint16 arrayValue : container.values)
+                {
+                    container.bitmap[arrayValue >> 6] |= uint64(1) << (arrayValue & 63);
+                }
+
+                std::vector<uint16>().swap(container.values);
+            }
+        }
+        else
+        {
+            uint64& word = container.bitmap[value >> 6];
+            const uint64 bit = uint64(1) << (value & 63);
+            if (word & bit)
+                return false;
+
+            word |= bit;
+        }
+
+        size++;
+        hash += HashPosition(index);
+
+        if (history.size() >= MaxHistorySize)
+        {
+            StartHistory();
+        }
+        else
+        {
+            history.push_back(index);
+        }
+
+        return true;
+    }
+
+    uint64 TransmogCollection::HashPosition(uint32 index)
+    {
+        // splitmix64 finalizer, the sum of the mixed positions does not depend on the order they were added
+        uint64 value = index + 0x9E3779B97F4A7C15ULL;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+        return value ^ (value >> 31);
+    }
+
+    void TransmogCollection::StartHistory()
+    {
+        historyBaseHash = hash;
+        history.clear();
+    }
+
+    void TransmogCollection::Clear()
+    {
+        containers.clear();
+        size = 0;
+        hash = 0;
+        StartHistory();
+    }
+
+    void TransmogCollection::Intersect(const std::vector<uint64>& bitmap, std::vector<uint32>& selection) const
+    {
+        selection.clear();
+
+        const uint32 bitmapWords = bitmap.size();
+        for (const Container& container : containers)
+        {
+            const uint32 base = uint32(container.key) << 16;
+            const uint32 firstWord = base >> 6;
+            if (firstWord >= bitmapWords)
+                break;
+
+            if (container.bitmap.empty())
+            {
+                for (const uint16 value : container.values)
+                {
+                    const uint32 index = base | value;
+                    if ((index >> 6) < bitmapWords && (bitmap[index >> 6] >> (index & 63)) & 1)
+                    {
+                        selection.push_back(index);
+                    }
+                }
+            }
+            else
+            {
+                const uint32 words = std::min(BitmapContainerWords, bitmapWords - firstWord);
+                for (uint32 word = 0; word < words; ++word)
+                {
+                    for (uint64 bits = container.bitmap[word] & bitmap[firstWord + word]; bits; bits &= bits - 1)
+                    {
+                        selection.push_back(base | (word << 6) | GetLowestBit(bits));
+                    }
+                }
+            }
+        }
+    }
+
+    size_t TransmogCollection::GetMemoryUsage() const
+    {
+        size_t memory = sizeof(TransmogCollection) + containers.capacity() * sizeof(Container);
+        for (const Container& container : containers)
+        {
+            memory += container.values.capacity() * sizeof(uint16);
+            memory += container.bitmap.capacity() * sizeof(uint64);
+        }
+
+        memory += history.capacity() * sizeof(uint32);
+
+        return memory;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef CMANGOS_MODULE_TRANSMOG_COLLECTION_H
+#define CMANGOS_MODULE_TRANSMOG_COLLECTION_H
+
+#include "Platform/Define.h"
+
+#include <vector>
+
+namespace cmangos_module
+{
+    // Discovered transmogs of a player stored as a compressed set of catalog positions.
+    // Like roaring bitmaps, the positions are split in blocks of 65536 values and each block
+    // is kept as a sorted array while it is sparse and as a plain bitmap once it gets dense.
+    class TransmogCollection
+    {
+    public:
+        TransmogCollection() : size(0), hash(0), historyBaseHash(0) {}
+
+        bool Contains(uint32 index) const;
+        bool Add(uint32 index);
+        void Clear();
+
+        // Fills the positions (in ascending order) which are also set in the given bitmap
+        void Intersect(const std::vector<uint64>& bitmap, std::vector<uint32>& selection) const;
+
+        template <typename Callback>
+        void ForEach(Callback callback) const
+        {
+            for (const Container& container : containers)
+            {
+                const uint32 base = uint32(container.key) << 16;
+                if (container.bitmap.empty())
+                {
+                    for (const uint16 value : container.values)
+                    {
+                        callback(base | value);
+                    }
+                }
+                else
+                {
+                    for (uint32 word = 0; word < container.bitmap.size(); ++word)
+                    {
+                        for (uint64 bits = container.bitmap[word]; bits; bits &= bits - 1)
+                        {
+                            callback(base | (word << 6) | GetLowestBit(bits));
+                        }
+                    }
+                }
+            }
+        }
+
+        size_t Size() const { return size; }
+        size_t GetMemoryUsage() const;
+
+        // Order independent hash of the positions, updated as they are added
+        uint64 GetHash() const { return hash; }
+        static uint64 HashPosition(uint32 index);
+
+        // Positions added (in discovery order) since the history was started, the content it started from has the base hash
+        void StartHistory();
+        const std::vector<uint32>& GetHistory() const { return history; }
+        uint64 GetHistoryBaseHash() const { return historyBaseHash; }
+
+    private:
+        struct Container
+        {
+            uint16 key;
+            std::vector<uint16> values;     // Sorted values while the container is sparse
+            std::vector<uint64> bitmap;     // 65536 bits once the container is dense
+        };
+
+        static uint32 GetLowestBit(uint64 bits);
+
+        const Container* FindContainer(uint16 key) const;
+
+    private:
+        // Sorted by key
+        std::vector<Container> containers;
+        size_t size;
+
+        uint64 hash;
+        uint64 historyBaseHash;
+        std::vector<uint32> history;
+    };
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include "TransmogCollectionIndex.h"
+
+#include <algorithm>
+
+namespace cmangos_module
+{
+    // Amount of item ids sent on each addon message
+    constexpr uint32 ItemIDsPerMessage = 10;
+
+    void TransmogCollectionIndex::Clear()
+    {
+        for (std::map<uint32, TransmogIndexBucket>& buckets : slots)
+        {
+            buckets.clear();
+        }
+
+        collectionSize = 0;
+        playerFlags = 0;
+        built = false;
+    }
+
+    void TransmogCollectionIndex::Add(uint8 slot, uint32 itemClass, uint32 index)
+    {
+        TransmogIndexBucket& bucket = slots[slot][itemClass];
+        auto it = std::lower_bound(bucket.indexes.begin(), bucket.indexes.end(), index);
+        if (it == bucket.indexes.end() || *it != index)
+        {
+            bucket.indexes.insert(it, index);
+            bucket.messages.clear();
+        }
+    }
+
+    const std::vector<std::string>& TransmogCollectionIndex::GetMessages(const TransmogCatalog& catalog, uint8 slot, uint32 itemClass, TransmogIndexBucket& bucket, uint32 equippedItemID, uint8 protocol, uint32 maxMessageLength, bool& encoded)
+    {
+        size_t frontPosition = 0;
+        const uint32 frontItemID = GetFrontItemID(catalog, bucket, equippedItemID, frontPosition);
+
+        encoded = bucket.messages.empty() || bucket.frontItemID != frontItemID || bucket.protocol != protocol;
+        if (encoded)
+        {
+            bucket.messages.clear();
+            bucket.frontItemID = frontItemID;
+            bucket.protocol = protocol;
+
+            if (protocol >= TRANSMOG_PROTOCOL_PACKED)
+            {
+                EncodePacked(catalog, slot, itemClass, bucket, maxMessageLength, protocol >= TRANSMOG_PROTOCOL_ITEM_INFO);
+            }
+            else
+            {
+                EncodeText(catalog, slot, itemClass, bucket);
+            }
+        }
+
+        return bucket.messages;
+    }
+
+    void TransmogCollectionIndex::GetPage(const TransmogCatalog& catalog, const TransmogIndexBucket& bucket, uint32 equippedItemID, bool descending, uint32 offset, uint32 count, std::vector<uint32>& itemIDs) const
+    {
+        itemIDs.clear();
+
+        size_t frontPosition = 0;
+        const uint32 frontItemID = GetFrontItemID(catalog, bucket, equippedItemID, frontPosition);
+        const size_t total = bucket.indexes.size();
+        if (offset >= total)
+            return;
+
+        const size_t last = std::min<size_t>(total, size_t(offset) + count);
+        for (size_t position = offset; position < last; ++position)
+        {
+            if (frontItemID)
+            {
+                if (position == 0)
+                {
+                    itemIDs.push_back(frontItemID);
+                    continue;
+                }
+
+                // Position among the other items of the bucket, skipping the equipped one
+                size_t otherPosition = position - 1;
+                otherPosition = descending ? total - 2 - otherPosition : otherPosition;
+                itemIDs.push_back(catalog.GetEntry(bucket.indexes[otherPosition < frontPosition ? otherPosition : otherPosition + 1]).itemID);
+            }
+            else
+            {
+                itemIDs.push_back(catalog.GetEntry(bucket.indexes[descending ? total - 1 - position : position]).itemID);
+            }
+        }
+    }
+
+    uint32 TransmogCollectionIndex::GetFrontItemID(const TransmogCatalog& catalog, const TransmogIndexBucket& bucket, uint32 equippedItemID, size_t& frontPosition) const
+    {
+        // The equipped item only matters if it is one of the items of the bucket
+        if (const TransmogCatalogEntry* equippedEntry = catalog.Find(equippedItemID))
+        {
+            auto it = std::lower_bound(bucket.indexes.begin(), bucket.indexes.end(), catalog.GetIndex(*equippedEntry));
+            if (it != bucket.indexes.end() && *it == catalog.GetIndex(*equippedEntry))
+            {
+                frontPosition = it - bucket.indexes.begin();
+                return equippedItemID;
+            }
+        }
+
+        return 0;
+    }
+
+    void TransmogCollectionIndex::EncodeText(const TransmogCatalog& catalog, uint8 slot, uint32 itemClass, TransmogIndexBucket& bucket) const
+    {
+        const std::string header = "AvailableTransmogs:" + std::to_string(slot) + ":" + std::to_string(itemClass) + ":" + std::to_string(bucket.indexes.size()) + ":";
+        bucket.messages.push_back(header + "start");
+
+        std::string message;
+        uint32 itemIDs = 0;
+        auto AppendItemID = [&](uint32 itemID)
+        {
+            message += itemIDs == 0 ? header : ":";
+            message += std::to_string(itemID);
+            if (++itemIDs >= ItemIDsPerMessage)
+            {
+                bucket.messages.push_back(std::move(message));
+                message.clear();
+                itemIDs = 0;
+            }
+        };
+
+        if (bucket.frontItemID)
+        {
+            AppendItemID(bucket.frontItemID);
+        }
+
+        for (const uint32 index : bucket.indexes)
+        {
+            const uint32 itemID = catalog.GetEntry(index).itemID;
+            if (itemID != bucket.frontItemID)
+            {
+                AppendItemID(itemID);
+            }
+        }
+
+        if (itemIDs > 0)
+        {
+            bucket.messages.push_back(std::move(message));
+        }
+
+        bucket.messages.push_back(header + "end");
+    }
+
+    void TransmogCollectionIndex::EncodePacked(const TransmogCatalog& catalog, uint8 slot, uint32 itemClass, TransmogIndexBucket& bucket, uint32 maxMessageLength, bool itemInfo) const
+    {
+        // The client resets the bucket with the first part and shows it once it has received every item.
+        // Each part starts from 0 so it does not depend on the previous ones.
+        const std::string header = "PackedTransmogs:" + std::to_string(slot) + ":" + std::to_string(itemClass) + ":" + std::to_string(bucket.indexes.size()) + ":";
+
+        // The item info of the part goes after its ids, in the same order
+        const uint32 maxItemLength = TRANSMOG_MAX_PACKED_ID_LENGTH + (itemInfo ? TRANSMOG_MAX_PACKED_INFO_LENGTH : 0);
+        const uint32 itemInfoSeparatorLength = itemInfo ? 1 : 0;
+
+        std::string message;
+        std::string itemInfos;
+        uint32 previousItemID = 0;
+        auto FinishMessage = [&]()
+        {
+            if (itemInfo)
+            {
+                message += ':';
+                message += itemInfos;
+                itemInfos.clear();
+            }
+
+            bucket.messages.push_back(std::move(message));
+            message.clear();
+        };
+
+        auto AppendItem = [&](const TransmogCatalogEntry& entry)
+        {
+            if (message.empty())
+            {
+                message = header + std::to_string(bucket.messages.size()) + ":";
+                previousItemID = 0;
+            }
+
+            AppendPackedID(message, entry.itemID, previousItemID);
+            if (itemInfo)
+            {
+                AppendPackedNumber(itemInfos, GetPackedItemInfo(entry.inventoryType, entry.quality));
+            }
+
+            if (message.size() + itemInfoSeparatorLength + itemInfos.size() + maxItemLength > maxMessageLength)
+            {
+                FinishMessage();
+            }
+        };
+
+        if (bucket.frontItemID)
+        {
+            AppendItem(*catalog.Find(bucket.frontItemID));
+        }
+
+        for (const uint32 index : bucket.indexes)
+        {
+            const TransmogCatalogEntry& entry = catalog.GetEntry(index);
+            if (entry.itemID != bucket.frontItemID)
+            {
+                AppendItem(entry);
+            }
+        }
+
+        if (!message.empty())
+        {
+            FinishMessage();
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#ifndef CMANGOS_MODULE_TRANSMOG_COLLECTION_INDEX_H
+#define CMANGOS_MODULE_TRANSMOG_COLLECTION_INDEX_H
+
+#include "TransmogAddonProtocol.h"
+#include "TransmogCatalog.h"
+
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cmangos_module
+{
+    struct TransmogIndexBucket
+    {
+        // Catalog positions of the items, sorted (same order as the item ids)
+        std::vector<uint32> indexes;
+
+        // Encoded addon messages of the bucket, empty when they have to be encoded again
+        std::vector<std::string> messages;
+
+        // Item sent first in the encoded messages (the equipped one), 0 if none
+        uint32 frontItemID = 0;
+
+        // Addon protocol of the encoded messages
+        uint8 protocol = 0;
+    };
+
+    // Discovered transmogs of a player grouped the way they are sent to the client addon
+    // (slot -> item class + item subclass -> items). It is updated in place when new items
+    // are discovered, and every bucket keeps its encoded messages until it changes.
+    class TransmogCollectionIndex
+    {
+    public:
+        TransmogCollectionIndex() : collectionSize(0), playerFlags(0), built(false) {}
+
+        // The index has to be built again if the collection changed somewhere else or the off hand capabilities changed
+        bool IsBuilt(size_t collectionSize, uint8 playerFlags) const
+        {
+            return built && this->collectionSize == collectionSize && this->playerFlags == playerFlags;
+        }
+
+        void SetBuilt(size_t collectionSize, uint8 playerFlags)
+        {
+            this->collectionSize = collectionSize;
+            this->playerFlags = playerFlags;
+            built = true;
+        }
+
+        void Clear();
+        void Add(uint8 slot, uint32 itemClass, uint32 index);
+
+        std::map<uint32, TransmogIndexBucket>& GetSlotBuckets(uint8 slot) { return slots[slot]; }
+
+        // Encoded messages of the bucket, the equipped item (if in the bucket) goes first.
+        // Packed messages are filled up to the given length, with the item info of their items if the protocol has it.
+        const std::vector<std::string>& GetMessages(const TransmogCatalog& catalog, uint8 slot, uint32 itemClass, TransmogIndexBucket& bucket, uint32 equippedItemID, uint8 protocol, uint32 maxMessageLength, bool& encoded);
+
+        // Item ids of a page of the bucket, in the same order as the messages (the equipped item first, then by item id).
+        // Descending only reverses the items after the equipped one.
+        void GetPage(const TransmogCatalog& catalog, const TransmogIndexBucket& bucket, uint32 equippedItemID, bool descending, uint32 offset, uint32 count, std::vector<uint32>& itemIDs) const;
+
+    private:
+        uint32 GetFrontItemID(const TransmogCatalog& catalog, const TransmogIndexBucket& bucket, uint32 equippedItemID, size_t& frontPosition) const;
+        void EncodeText(const TransmogCatalog& catalog, uint8 slot, uint32 itemClass, TransmogIndexBucket& bucket) const;
+        void EncodePacked(const TransmogCatalog& catalog, uint8 slot, uint32 itemClass, TransmogIndexBucket& bucket, uint32 maxMessageLength, bool itemInfo) const;
+
+    private:
+        std::array<std::map<uint32, TransmogIndexBucket>, TRANSMOG_EQUIPMENT_SLOTS> slots;
+        size_t collectionSize;
+        uint8 playerFlags;
+        bool built;
+    };
+}
+#endif
\ No newline at end of file
@@ -1,8 +1,10 @@
 #include "TransmogModule.h"
+#include "TransmogBlob.h"
 
 #include "Entities/GossipDef.h"
 #include "Entities/Player.h"
 #include "Globals/ObjectMgr.h"
+#include "World/World.h"
 
 #ifdef ENABLE_PLAYERBOTS
 #include "playerbot/PlayerbotAI.h"
@@ -10,43 +12,109 @@
 
 namespace cmangos_module
 {
-    void SendAddOnMessage(const Player* player, const char* prefix, const char* message)
+    // Relative catalog files go in the DataDir of the server, not in its working directory
+    static std::string GetCatalogPath(const std::string& catalogFile)
     {
-        WorldPacket data;
+        if (catalogFile.empty() || catalogFile[0] == '/' || catalogFile[0] == '\\' || (catalogFile.size() > 1 && catalogFile[1] == ':'))
+            return catalogFile;
 
-        std::ostringstream out;
-        if (strstr(prefix, "") != NULL)
-        {
-            out << prefix << "\t" << message;
-        }
-        else
-        {
-            out << message;
-        }
+        return sWorld.GetDataPath() + catalogFile;
+    }
 
-        char* buf = mangos_strdup(out.str().c_str());
-        char* pos = buf;
+    static_assert(TRANSMOG_EQUIPMENT_SLOTS == EQUIPMENT_SLOT_END, "The transmog slots must cover every equipment slot");
 
-        while (char* line = ChatHandler::LineFromMessage(pos))
+    void SendAddOnMessage(const Player* player, const char* prefix, const char* message, size_t messageLength)
+    {
+        // Reused by every message sent from this thread, nothing is allocated once they have grown
+        thread_local std::string buffer;
+        thread_local WorldPacket data;
+
+        buffer.assign(prefix);
+        buffer += '\t';
+        buffer.append(message, messageLength);
+
+        // Each line is sent as its own message (empty lines are skipped)
+        char* pos = &buffer[0];
+        char* const end = pos + buffer.size();
+        while (pos < end)
         {
+            char* lineEnd = static_cast<char*>(memchr(pos, '\n', end - pos));
+            if (!lineEnd)
+            {
+                lineEnd = end;
+            }
+
+            if (lineEnd != pos)
+            {
+                *lineEnd = '\0';
 #if EXPANSION == 0
-            ChatHandler::BuildChatPacket(data, CHAT_MSG_ADDON, line, LANG_ADDON);
+                ChatHandler::BuildChatPacket(data, CHAT_MSG_ADDON, pos, LANG_ADDON);
 #else
-            ChatHandler::BuildChatPacket(data, CHAT_MSG_WHISPER, line, LANG_ADDON);
+                ChatHandler::BuildChatPacket(data, CHAT_MSG_WHISPER, pos, LANG_ADDON);
 #endif
-            player->GetSession()->SendPacket(data);
+                player->GetSession()->SendPacket(data);
+            }
+
+            pos = lineEnd + 1;
         }
+    }
 
-        delete[] buf;
+    void SendAddOnMessage(const Player* player, const char* prefix, const char* message)
+    {
+        SendAddOnMessage(player, prefix, message, strlen(message));
     }
 
     void SendAddOnMessage(const Player* player, const char* prefix, const std::string& message)
     {
-        SendAddOnMessage(player, prefix, message.c_str());
+        SendAddOnMessage(player, prefix, message.c_str(), message.size());
+    }
+
+    void SendAddOnMessage(const Player* player, const char* prefix, const TransmogAddonMessage& message)
+    {
+        // A message cut in the middle of a value would be read wrong by the client
+        if (message.IsTruncated())
+        {
+            sLog.outError("Transmog addon message too long, not sent: %s", message.c_str());
+            return;
+        }
+
+        SendAddOnMessage(player, prefix, message.c_str(), message.size());
     }
 
     TransmogModule::TransmogModule()
     : Module("Transmog", new TransmogModuleConfig())
+    , skippedHookCalls(0U)
+    , encodedResponses(0U)
+    , cachedResponses(0U)
+    , sentResponseMessages(0U)
+    , sentResponseBytes(0U)
+    , catalogChecksum(0U)
+    , currentSyncs(0U)
+    , deltaSyncs(0U)
+    , fullSyncs(0U)
+    , sentPages(0U)
+    , lastStreamPlayer(0U)
+    , streamedMessages(0U)
+    , cancelledStreams(0U)
+    , discoveryDeltaMessages(0U)
+    , coalescedDiscoveries(0U)
+    , cacheHits(0U)
+    , cacheMisses(0U)
+    , flushTimer(0U)
+    , oldestPendingWriteTime(0U)
+    , maxPendingWrites(0U)
+    , lastFlushLatency(0U)
+    , maxFlushLatency(0U)
+    , lastFlushDuration(0U)
+    , flushedRows(0U)
+    , flushedStatements(0U)
+    , migrationTimer(0U)
+    , migrationLastOwner(0U)
+    , migrationRunning(false)
+    , migrationFinished(false)
+    , migratedCollections(0U)
+    , migratedRows(0U)
+    , compactedCollections(0U)
     {
 
     }
@@ -63,235 +131,914 @@ namespace cmangos_module
             // Cleanup non existent characters
             CharacterDatabase.PExecute("DELETE FROM `custom_transmog_active` WHERE NOT EXISTS (SELECT 1 FROM `characters` WHERE `characters`.`guid` = `custom_transmog_active`.`player`);");
             CharacterDatabase.PExecute("DELETE FROM `custom_transmog_discovered` WHERE NOT EXISTS (SELECT 1 FROM `characters` WHERE `characters`.`guid` = `custom_transmog_discovered`.`player`);");
+            if (IsBlobStorage())
+            {
+                CharacterDatabase.PExecute("DELETE FROM `custom_transmog_collection` WHERE NOT EXISTS (SELECT 1 FROM `characters` WHERE `characters`.`guid` = `custom_transmog_collection`.`player`);");
+            }
+
+            if (GetConfig()->accountWide)
+            {
+                // Cleanup the account wide collections of accounts without characters (deleted accounts take their characters with them)
+                CharacterDatabase.PExecute("DELETE FROM `custom_transmog_account_discovered` WHERE NOT EXISTS (SELECT 1 FROM `characters` WHERE `characters`.`account` = `custom_transmog_account_discovered`.`account`);");
+                if (IsBlobStorage())
+                {
+                    CharacterDatabase.PExecute("DELETE FROM `custom_transmog_account_collection` WHERE NOT EXISTS (SELECT 1 FROM `characters` WHERE `characters`.`account` = `custom_transmog_account_collection`.`account`);");
+                }
+
+                // Move the characters collections into the account wide ones, also the ones discovered while the mode was disabled.
+                // The merged rows are removed so the next start does not bring them back once they are migrated into a blob.
+                CharacterDatabase.BeginTransaction();
+                CharacterDatabase.Execute("INSERT IGNORE INTO `custom_transmog_account_discovered` (`account`, `item_entry`) "
+                    "SELECT DISTINCT `characters`.`account`, `custom_transmog_discovered`.`item_entry` FROM `custom_transmog_discovered` "
+                    "JOIN `characters` ON `characters`.`guid` = `custom_transmog_discovered`.`player`");
+                CharacterDatabase.Execute("DELETE FROM `custom_transmog_discovered` WHERE EXISTS (SELECT 1 FROM `characters` WHERE `characters`.`guid` = `custom_transmog_discovered`.`player`)");
+                CharacterDatabase.CommitTransaction();
+            }
 		    
             // Delete corrupted transmog items
 		    CharacterDatabase.Execute("DELETE FROM `custom_transmog_active` WHERE NOT EXISTS (SELECT 1 FROM `item_instance` WHERE `item_instance`.`guid` = `custom_transmog_active`.`item_guid`)");
+
+            playerCache.SetLimits(GetConfig()->cacheSize, GetConfig()->cacheTTL);
+            rateLimiter.SetLimits(GetConfig()->rateLimitTokens, GetConfig()->rateLimitRefill);
+
+            // Reuse the catalog file of a previous start if the item templates have not changed
+            const uint32 catalogStartTime = WorldTimer::getMSTime();
+            const std::string catalogPath = GetCatalogPath(GetConfig()->catalogFile);
+            catalogChecksum = TransmogCatalog::CalculateChecksum();
+            if (!catalog.LoadFile(catalogPath, catalogChecksum))
+            {
+                catalog.Build(GetConfig()->catalogThreads);
+                if (!catalogPath.empty() && !catalog.SaveFile(catalogPath, catalogChecksum))
+                {
+                    sLog.outError("Transmog: Failed to write the catalog file %s", catalogPath.c_str());
+                }
+            }
+
+            sLog.outString("Transmog: %s %u items with %u different appearances in %u ms", catalog.IsMapped() ? "Mapped" : "Built", (uint32)catalog.Size(), catalog.GetDisplayGroupsCount(), WorldTimer::getMSTimeDiff(catalogStartTime, WorldTimer::getMSTime()));
 	    }
     }
 
+    void TransmogModule::OnUpdate(uint32 elapsed)
+    {
+        if (GetConfig()->enabled)
+        {
+            playerCache.RemoveExpired(time(nullptr));
+
+            if (GetPendingWritesCount() > 0)
+            {
+                // Nothing queued can wait for the next flush once the server is going down,
+                // the players still online are flushed again when they are kicked on shutdown
+                flushTimer += elapsed;
+                if (World::IsStopped() || sWorld.IsShutdowning() || flushTimer >= GetConfig()->flushInterval || GetPendingWritesCount() >= GetConfig()->flushThreshold)
+                {
+                    FlushPendingWrites();
+                }
+            }
+
+            if (!pendingDiscoveries.empty())
+            {
+                SendPendingDiscoveries();
+            }
+
+            if (!streams.empty())
+            {
+                UpdateStreams();
+            }
+
+            // Move the discovered transmog rows into the collection blobs a few players at a time
+            if (IsBlobStorage() && !migrationFinished && !migrationRunning && GetConfig()->migrationBatchSize > 0)
+            {
+                migrationTimer += elapsed;
+                if (migrationTimer >= GetConfig()->migrationInterval)
+                {
+                    migrationTimer = 0;
+                    MigrateDiscoveredTransmogs();
+                }
+            }
+        }
+    }
+
     void TransmogModule::OnLoadFromDB(Player* player)
     {
         if (GetConfig()->enabled)
         {
 		    if (player)
 		    {
+                const uint32 playerID = player->GetObjectGuid().GetCounter();
+
+                // Decide once if the player is handled by the module, the hooks will only check this flag
 #ifdef ENABLE_PLAYERBOTS
                 if (sRandomPlayerbotMgr.IsFreeBot(player))
+                {
+                    SetTrackedPlayer(playerID, false);
                     return;
+                }
 #endif
 
-                LoadActiveTransmogs(player);
-                LoadDiscoveredTransmogs(player);
-		    }
-	    }
-    }
+                SetTrackedPlayer(playerID, true);
 
-    void TransmogModule::OnLogOut(Player* player)
-    {
-	    if (GetConfig()->enabled)
-	    {
-            if (player)
-            {
-#ifdef ENABLE_PLAYERBOTS
-                if (sRandomPlayerbotMgr.IsFreeBot(player))
-                    return;
-#endif
+                // Reuse the state of a recent session if possible
+                if (playerCache.IsEnabled())
+                {
+                    TransmogCachedPlayer cachedPlayer;
+                    if (playerCache.Take(playerID, cachedPlayer, time(nullptr)) && cachedPlayer.race == player->getRace())
+                    {
+                        cacheHits++;
+                        LoadCachedTransmogs(player, cachedPlayer);
+                        return;
+                    }
 
-			    // Unload transmog config
-                const uint32 playerID = player->GetObjectGuid().GetCounter();
-                for (auto it = entryMap[playerID].begin(); it != entryMap[playerID].end(); ++it)
+                    cacheMisses++;
+                }
+
+                loadingPlayers.insert(playerID);
+
+                // The account collection is already loaded by another character, it is attached once the active transmogs are loaded
+                const bool sharedCollection = !GetConfig()->lazyCollection && FindSharedCollection(GetCollectionOwner(player));
+                if (sharedCollection)
                 {
-                    dataMap.erase(it->first);
+                    lazyCollections[playerID] = TransmogLazyCollection();
                 }
 
-                entryMap.erase(playerID);
-                playerDiscoveredTransmogs.erase(playerID);
-            }
+                // The discovered transmogs will be loaded once the player needs them
+                if (GetConfig()->lazyCollection || sharedCollection)
+                {
+                    CharacterDatabase.AsyncPQuery(this, &TransmogModule::HandleTransmogsLoaded, playerID,
+                        "SELECT 0, `item_guid`, `transmog_entry`, '' FROM `custom_transmog_active` WHERE `player` = %u",
+                        playerID);
+                }
+                else if (IsBlobStorage())
+                {
+                    // Rows not migrated yet are merged with the collection blob
+                    const uint32 collectionOwner = GetCollectionOwner(player);
+                    CharacterDatabase.AsyncPQuery(this, &TransmogModule::HandleTransmogsLoaded, playerID,
+                        "SELECT 0, `item_guid`, `transmog_entry`, '' FROM `custom_transmog_active` WHERE `player` = %u "
+                        "UNION ALL "
+                        "SELECT 1, `item_entry`, 0, '' FROM `%s` WHERE `%s` = %u "
+                        "UNION ALL "
+                        "SELECT 2, `segments`, `version`, HEX(`data`) FROM `%s` WHERE `%s` = %u",
+                        playerID, GetDiscoveredTable(), GetOwnerColumn(), collectionOwner, GetCollectionTable(), GetOwnerColumn(), collectionOwner);
+                }
+                else
+                {
+                    // Fetch the active and discovered transmogs in a single asynchronous query
+                    CharacterDatabase.AsyncPQuery(this, &TransmogModule::HandleTransmogsLoaded, playerID,
+                        "SELECT 0, `item_guid`, `transmog_entry`, '' FROM `custom_transmog_active` WHERE `player` = %u "
+                        "UNION ALL "
+                        "SELECT 1, `item_entry`, 0, '' FROM `%s` WHERE `%s` = %u",
+                        playerID, GetDiscoveredTable(), GetOwnerColumn(), GetCollectionOwner(player));
+                }
+		    }
 	    }
     }
 
-    void TransmogModule::OnDeleteFromDB(uint32 playerId)
+    void TransmogModule::HandleTransmogsLoaded(QueryResult* queryResult, uint32 playerID)
     {
-        if (GetConfig()->enabled)
-        {
-		    CharacterDatabase.PExecute("DELETE FROM `custom_transmog_active` WHERE `player` = %u", playerId);
-            CharacterDatabase.PExecute("DELETE FROM `custom_transmog_discovered` WHERE `player` = %u", playerId);
+        std::unique_ptr<QueryResult> result(queryResult);
 
-            // Unload transmog config
-            for (auto it = entryMap[playerId].begin(); it != entryMap[playerId].end(); ++it)
+        // The player may have logged out before the query finished
+        if (loadingPlayers.erase(playerID) == 0)
+            return;
+
+        Player* player = sObjectMgr.GetPlayer(ObjectGuid(HIGHGUID_PLAYER, playerID));
+        if (!player)
+            return;
+
+        std::vector<std::pair<uint32, uint32>> activeTransmogs;
+        TransmogStoredCollection storedCollection;
+        if (result)
+        {
+            do
             {
-                dataMap.erase(it->first);
+                ReadStoredTransmog(result->Fetch(), playerID, activeTransmogs, storedCollection);
             }
+            while (result->NextRow());
+        }
 
-            entryMap.erase(playerId);
-            playerDiscoveredTransmogs.erase(playerId);
-	    }
-    }
+        LoadActiveTransmogs(player, activeTransmogs);
 
-    void TransmogModule::OnSetVisibleItemSlot(Player* player, uint8 slot, Item* item)
-    {
-	    if (GetConfig()->enabled)
-	    {
-		    if (player && item)
-		    {
-#ifdef ENABLE_PLAYERBOTS
-                if (sRandomPlayerbotMgr.IsFreeBot(player))
-                    return;
-#endif
+        // Answer the addon if it asked for the collection while the player was logging in
+        const bool sendWhenLoaded = collectionRequests.erase(playerID) > 0;
 
-                if (uint32 entry = GetTransmogAppearance(item))
-			    {
-#if EXPANSION == 2
-                    player->SetUInt32Value(PLAYER_VISIBLE_ITEM_1_ENTRYID + item->GetSlot() * 2, entry);
-#else
-                    player->SetUInt32Value(PLAYER_VISIBLE_ITEM_1_0 + item->GetSlot() * MAX_VISIBLE_ITEM_OFFSET, entry);
-#endif
-			    }
-		    }
-	    }
+        if (GetConfig()->lazyCollection)
+        {
+            lazyCollections[playerID] = TransmogLazyCollection();
+            if (sendWhenLoaded || pendingPageRequests.find(playerID) != pendingPageRequests.end())
+            {
+                LoadDiscoveredTransmogsIfNeeded(player, sendWhenLoaded);
+            }
+        }
+        else if (lazyCollections.find(playerID) != lazyCollections.end())
+        {
+            // Attach the account collection, or load it if its characters logged out meanwhile
+            LoadDiscoveredTransmogsIfNeeded(player, sendWhenLoaded);
+        }
+        else
+        {
+            if (playerDiscoveredTransmogs.find(playerID) == playerDiscoveredTransmogs.end())
+            {
+                FinishStoredCollection(GetCollectionOwner(player), storedCollection);
+                LoadDiscoveredTransmogs(player, storedCollection.itemEntries);
+                SendPendingTransmogPage(player);
+            }
+
+            if (sendWhenLoaded)
+            {
+                SyncDiscoveredTransmogs(player);
+            }
+        }
     }
 
-    void TransmogModule::OnEquipItem(Player* player, Item* item)
+    void TransmogModule::LoadCachedTransmogs(Player* player, TransmogCachedPlayer& cachedPlayer)
     {
-        if (GetConfig()->enabled)
+        const uint32 playerID = player->GetObjectGuid().GetCounter();
+        LoadActiveTransmogs(player, cachedPlayer.activeTransmogs);
+
+        if (cachedPlayer.collectionLoaded)
         {
-            if (player && item)
+            // Another character of the account may have loaded the collection again in the meantime
+            std::shared_ptr<TransmogCollection> collection = FindSharedCollection(GetCollectionOwner(player));
+            if (!collection)
             {
-#ifdef ENABLE_PLAYERBOTS
-                if (sRandomPlayerbotMgr.IsFreeBot(player))
-                    return;
-#endif
-                // Don't consider items if the player has not finished loading from DB
-                if (playerDiscoveredTransmogs.find(player->GetObjectGuid().GetCounter()) != playerDiscoveredTransmogs.end())
+                collection = std::move(cachedPlayer.discoveredTransmogs);
+                if (GetConfig()->accountWide)
                 {
-                    const uint32 itemEntry = item->GetEntry();
-                    if (IsValidTransmog(player, itemEntry))
-                    {
-                        AddDiscoveredTransmog(player, itemEntry, true, true);
-                    }
+                    sharedCollections[GetCollectionOwner(player)] = collection;
                 }
             }
+
+            playerDiscoveredTransmogs[playerID] = std::move(collection);
+        }
+        else
+        {
+            // The collection was never loaded during the last session
+            lazyCollections[playerID] = TransmogLazyCollection();
+            if (!GetConfig()->lazyCollection)
+            {
+                LoadDiscoveredTransmogsIfNeeded(player, false);
+            }
         }
     }
 
-    void TransmogModule::OnMoveItemFromInventory(Player* player, Item* item)
+    void TransmogModule::LoadDiscoveredTransmogsIfNeeded(const Player* player, bool sendWhenLoaded)
     {
-        if (GetConfig()->enabled)
+        const uint32 playerID = player->GetObjectGuid().GetCounter();
+        if (playerDiscoveredTransmogs.find(playerID) != playerDiscoveredTransmogs.end())
         {
-            if (player && item)
+            if (sendWhenLoaded)
             {
-#ifdef ENABLE_PLAYERBOTS
-                if (sRandomPlayerbotMgr.IsFreeBot(player))
-                    return;
-#endif
+                SyncDiscoveredTransmogs(player);
+            }
 
-			    RemoveTransmog(player, item, false);
-		    }
-	    }
-    }
+            return;
+        }
 
-    std::vector<ModuleChatCommand>* TransmogModule::GetCommandTable()
-    {
-        static std::vector<ModuleChatCommand> commandTable =
+        // Not loaded yet, either the player is still logging in or the collection is lazy loaded
+        if (loadingPlayers.find(playerID) != loadingPlayers.end())
         {
-            { "GetTransmogStatus", std::bind(&TransmogModule::HandleTransmogStatus, this, std::placeholders::_1, std::placeholders::_2), SEC_PLAYER },
-            { "GetAvailableTransmogs", std::bind(&TransmogModule::HandleGetAvailableTransmogs, this, std::placeholders::_1, std::placeholders::_2), SEC_PLAYER },
-            { "CalculateTransmogCost", std::bind(&TransmogModule::HandleCalculateTransmogCost, this, std::placeholders::_1, std::placeholders::_2), SEC_PLAYER },
-            { "ApplyTransmog", std::bind(&TransmogModule::HandleApplyTransmog, this, std::placeholders::_1, std::placeholders::_2), SEC_PLAYER }
-        };
+            if (sendWhenLoaded)
+            {
+                collectionRequests.insert(playerID);
+            }
 
-        return &commandTable;
+            return;
+        }
+
+        auto it = lazyCollections.find(playerID);
+        if (it != lazyCollections.end())
+        {
+            TransmogLazyCollection& lazyCollection = it->second;
+            lazyCollection.sendWhenLoaded |= sendWhenLoaded;
+
+            // Share the collection of another character of the account if it is loaded
+            const uint32 collectionOwner = GetCollectionOwner(player);
+            if (std::shared_ptr<TransmogCollection> collection = FindSharedCollection(collectionOwner))
+            {
+                const TransmogLazyCollection sharedLazyCollection = lazyCollection;
+                lazyCollections.erase(it);
+                playerDiscoveredTransmogs[playerID] = std::move(collection);
+                FinishLazyCollection(player, sharedLazyCollection);
+                return;
+            }
+
+            if (!lazyCollection.loading)
+            {
+                lazyCollection.loading = true;
+                if (IsBlobStorage())
+                {
+                    CharacterDatabase.AsyncPQuery(this, &TransmogModule::HandleDiscoveredTransmogsLoaded, playerID,
+                        "SELECT 1, `item_entry`, 0, '' FROM `%s` WHERE `%s` = %u "
+                        "UNION ALL "
+                        "SELECT 2, `segments`, `version`, HEX(`data`) FROM `%s` WHERE `%s` = %u",
+                        GetDiscoveredTable(), GetOwnerColumn(), collectionOwner, GetCollectionTable(), GetOwnerColumn(), collectionOwner);
+                }
+                else
+                {
+                    CharacterDatabase.AsyncPQuery(this, &TransmogModule::HandleDiscoveredTransmogsLoaded, playerID,
+                        "SELECT 1, `item_entry`, 0, '' FROM `%s` WHERE `%s` = %u",
+                        GetDiscoveredTable(), GetOwnerColumn(), collectionOwner);
+                }
+            }
+        }
     }
 
-    bool TransmogModule::HandleTransmogStatus(WorldSession* session, const std::string& args)
+    void TransmogModule::HandleDiscoveredTransmogsLoaded(QueryResult* queryResult, uint32 playerID)
     {
-        if (GetConfig()->enabled)
+        std::unique_ptr<QueryResult> result(queryResult);
+
+        // The player may have logged out before the query finished
+        auto it = lazyCollections.find(playerID);
+        if (it == lazyCollections.end())
+            return;
+
+        const TransmogLazyCollection lazyCollection = it->second;
+        lazyCollections.erase(it);
+
+        Player* player = sObjectMgr.GetPlayer(ObjectGuid(HIGHGUID_PLAYER, playerID));
+        if (!player)
+            return;
+
+        std::vector<std::pair<uint32, uint32>> activeTransmogs;
+        TransmogStoredCollection storedCollection;
+        if (result)
         {
-            Player* player = session->GetPlayer();
-            if (player)
+            do
             {
-                SendActiveTransmogs(player);
-                return true;
+                ReadStoredTransmog(result->Fetch(), playerID, activeTransmogs, storedCollection);
             }
+            while (result->NextRow());
         }
 
-        return false;
+        // Another character of the account may have loaded the collection while waiting
+        if (std::shared_ptr<TransmogCollection> collection = FindSharedCollection(GetCollectionOwner(player)))
+        {
+            playerDiscoveredTransmogs[playerID] = std::move(collection);
+        }
+        else
+        {
+            FinishStoredCollection(GetCollectionOwner(player), storedCollection);
+            LoadDiscoveredTransmogs(player, storedCollection.itemEntries);
+        }
+
+        FinishLazyCollection(player, lazyCollection);
     }
 
-    bool TransmogModule::HandleGetAvailableTransmogs(WorldSession* session, const std::string& args)
+    void TransmogModule::FinishLazyCollection(const Player* player, const TransmogLazyCollection& lazyCollection)
     {
-        if (GetConfig()->enabled)
+        // Merge the items discovered while the collection was not loaded
+        for (const uint32 itemEntry : lazyCollection.discoveries)
         {
-            Player* player = session->GetPlayer();
-            if (player)
-            {
-                SendDiscoveredTransmogs(player);
-                return true;
-            }
+            AddDiscoveredTransmog(player, itemEntry, true, true);
         }
 
-        return false;
+        if (lazyCollection.sendWhenLoaded)
+        {
+            SyncDiscoveredTransmogs(player);
+        }
+
+        SendPendingTransmogPage(player);
     }
 
-    bool TransmogModule::HandleCalculateTransmogCost(WorldSession* session, const std::string& args)
+    uint32 TransmogModule::GetCollectionOwner(const Player* player) const
     {
-        if (GetConfig()->enabled)
+        return GetConfig()->accountWide ? player->GetSession()->GetAccountId() : player->GetObjectGuid().GetCounter();
+    }
+
+    std::shared_ptr<TransmogCollection> TransmogModule::FindSharedCollection(uint32 collectionOwner)
+    {
+        if (GetConfig()->accountWide)
         {
-            Player* player = session->GetPlayer();
-            if (player)
+            auto it = sharedCollections.find(collectionOwner);
+            if (it != sharedCollections.end())
             {
-                std::vector<std::pair<uint32, uint32>> slots;
-                std::vector<std::string> slotsStr = helper::SplitString(args, ",");
-                for (const auto& slotStr : slotsStr)
+                if (std::shared_ptr<TransmogCollection> collection = it->second.lock())
                 {
-                    std::vector<std::string> slotPair = helper::SplitString(slotStr, ":");
-                    if (slotPair.size() == 2)
-                    {
-                        if (helper::IsValidNumberString(slotPair[0]) && helper::IsValidNumberString(slotPair[1]))
-                        {
-                            const uint32 slot = std::stoi(slotPair[0]);
-                            const uint32 itemID = std::stoi(slotPair[1]);
-                            slots.push_back(std::make_pair(slot, itemID));
-                        }
-                    }
+                    return collection;
                 }
 
-                SendTransmogCost(player, slots);
-                return true;
+                sharedCollections.erase(it);
             }
         }
 
-        return false;
+        return nullptr;
     }
 
-    bool TransmogModule::HandleApplyTransmog(WorldSession* session, const std::string& args)
+    void TransmogModule::ReadStoredTransmog(Field* fields, uint32 playerID, std::vector<std::pair<uint32, uint32>>& activeTransmogs, TransmogStoredCollection& storedCollection) const
     {
-        if (GetConfig()->enabled)
+        switch (fields[0].GetUInt32())
         {
-            Player* player = session->GetPlayer();
-            if (player)
+            case 0:
             {
-                std::vector<std::pair<uint32, uint32>> slots;
-                std::vector<std::string> slotsStr = helper::SplitString(args, ",");
-                for (const auto& slotStr : slotsStr)
-                {
-                    std::vector<std::string> slotPair = helper::SplitString(slotStr, ":");
-                    if (slotPair.size() == 2)
-                    {
-                        if (helper::IsValidNumberString(slotPair[0]) && helper::IsValidNumberString(slotPair[1]))
-                        {
-                            const uint32 slot = std::stoi(slotPair[0]);
-                            const uint32 itemID = std::stoi(slotPair[1]);
-                            slots.push_back(std::make_pair(slot, itemID));
-                        }
-                    }
+                activeTransmogs.push_back(std::make_pair(fields[1].GetUInt32(), fields[2].GetUInt32()));
+                break;
+            }
+
+            case 1:
+            {
+                storedCollection.itemEntries.push_back(fields[1].GetUInt32());
+                storedCollection.legacyRows++;
+                break;
+            }
+
+            case 2:
+            {
+                const uint32 version = fields[2].GetUInt32();
+                if (version != TRANSMOG_BLOB_VERSION)
+                {
+                    sLog.outError("Transmog collection of player ID %u has an unknown version (%u), ignoring.", playerID, version);
+                    break;
+                }
+
+                if (!DecodeTransmogBlob(fields[3].GetString(), storedCollection.itemEntries))
+                {
+                    sLog.outError("Transmog collection of player ID %u is corrupted, keeping the readable part.", playerID);
+                }
+
+                storedCollection.segments = fields[1].GetUInt32();
+                break;
+            }
+
+            default: break;
+        }
+    }
+
+    void TransmogModule::FinishStoredCollection(uint32 collectionOwner, TransmogStoredCollection& storedCollection)
+    {
+        std::vector<uint32>& itemEntries = storedCollection.itemEntries;
+        std::sort(itemEntries.begin(), itemEntries.end());
+        itemEntries.erase(std::unique(itemEntries.begin(), itemEntries.end()), itemEntries.end());
+
+        // Rewrite the blob as a single segment once it has too many appended ones, or take the rows not migrated yet
+        if (IsBlobStorage() && (storedCollection.legacyRows > 0 || storedCollection.segments > GetConfig()->compactSegments))
+        {
+            // Items missing from the catalog are kept, LoadDiscoveredTransmogs only skips them in memory
+            std::string data;
+            EncodeTransmogSegment(itemEntries, data);
+
+            CharacterDatabase.BeginTransaction();
+            CharacterDatabase.PExecute("REPLACE INTO `%s` (`%s`, `version`, `segments`, `data`) VALUES (%u, %u, 1, X'%s')", GetCollectionTable(), GetOwnerColumn(), collectionOwner, TRANSMOG_BLOB_VERSION, data.c_str());
+            if (storedCollection.legacyRows > 0)
+            {
+                CharacterDatabase.PExecute("DELETE FROM `%s` WHERE `%s` = %u", GetDiscoveredTable(), GetOwnerColumn(), collectionOwner);
+                migratedCollections++;
+                migratedRows += storedCollection.legacyRows;
+            }
+
+            CharacterDatabase.CommitTransaction();
+            compactedCollections++;
+        }
+    }
+
+    void TransmogModule::MigrateDiscoveredTransmogs()
+    {
+        migrationRunning = true;
+        const char* owner = GetOwnerColumn();
+        CharacterDatabase.AsyncPQuery(this, &TransmogModule::HandleMigrationBatchLoaded, 0U,
+            "SELECT `d`.`%s`, `d`.`item_entry` FROM `%s` `d` "
+            "JOIN (SELECT DISTINCT `%s` FROM `%s` WHERE `%s` > %u ORDER BY `%s` LIMIT %u) `o` ON `o`.`%s` = `d`.`%s` "
+            "ORDER BY `d`.`%s`, `d`.`item_entry`",
+            owner, GetDiscoveredTable(), owner, GetDiscoveredTable(), owner, migrationLastOwner, owner, GetConfig()->migrationBatchSize, owner, owner, owner);
+    }
+
+    void TransmogModule::HandleMigrationBatchLoaded(QueryResult* queryResult, uint32 /*param*/)
+    {
+        std::unique_ptr<QueryResult> result(queryResult);
+        migrationRunning = false;
+
+        if (!result)
+        {
+            migrationFinished = true;
+            if (migratedCollections > 0)
+            {
+                sLog.outString("Transmog: Migrated the discovered transmogs of " UI64FMTD " %s (" UI64FMTD " rows) into collection blobs", migratedCollections, GetConfig()->accountWide ? "accounts" : "players", migratedRows);
+            }
+
+            return;
+        }
+
+        std::map<uint32, std::vector<uint32>> batch;
+        do
+        {
+            Field* fields = result->Fetch();
+            batch[fields[0].GetUInt32()].push_back(fields[1].GetUInt32());
+        }
+        while (result->NextRow());
+
+        // Appending keeps any segment written meanwhile, duplicates are removed when the blob is read.
+        // Nothing writes new rows in this storage mode so the rows of the batch can go away.
+        CharacterDatabase.BeginTransaction();
+        for (const auto& pair : batch)
+        {
+            std::string data;
+            EncodeTransmogSegment(pair.second, data);
+            CharacterDatabase.PExecute("INSERT INTO `%s` (`%s`, `version`, `segments`, `data`) VALUES (%u, %u, 1, X'%s') "
+                "ON DUPLICATE KEY UPDATE `data` = CONCAT(`data`, VALUES(`data`)), `segments` = `segments` + 1",
+                GetCollectionTable(), GetOwnerColumn(), pair.first, TRANSMOG_BLOB_VERSION, data.c_str());
+            CharacterDatabase.PExecute("DELETE FROM `%s` WHERE `%s` = %u", GetDiscoveredTable(), GetOwnerColumn(), pair.first);
+
+            migratedCollections++;
+            migratedRows += pair.second.size();
+        }
+
+        CharacterDatabase.CommitTransaction();
+        migrationLastOwner = batch.rbegin()->first;
+    }
+
+    void TransmogModule::OnLogOut(Player* player)
+    {
+	    if (GetConfig()->enabled)
+	    {
+            if (player)
+            {
+                const uint32 playerID = player->GetObjectGuid().GetCounter();
+                if (!IsTrackedPlayer(playerID))
+                    return;
+
+                SetTrackedPlayer(playerID, false);
+                const bool loaded = loadingPlayers.erase(playerID) == 0;
+                collectionRequests.erase(playerID);
+                const uint32 collectionOwner = GetCollectionOwner(player);
+
+                // Store the discoveries of a collection that was never loaded
+                auto lazyIt = lazyCollections.find(playerID);
+                if (lazyIt != lazyCollections.end())
+                {
+                    for (const uint32 itemEntry : lazyIt->second.discoveries)
+                    {
+                        QueueDiscoveredTransmog(playerID, collectionOwner, itemEntry);
+                    }
+
+                    lazyCollections.erase(lazyIt);
+                }
+
+                // Make sure nothing from this player is left behind in the write queue
+                FlushPendingWrites(playerID, collectionOwner);
+
+                // Keep the state around in case the player logs back in soon
+                if (loaded && playerCache.IsEnabled())
+                {
+                    TransmogCachedPlayer cachedPlayer;
+                    cachedPlayer.race = player->getRace();
+                    if (const std::vector<uint32>* itemGUIDs = appearanceIndex.GetPlayerItems(playerID))
+                    {
+                        for (const uint32 itemGUID : *itemGUIDs)
+                        {
+                            cachedPlayer.activeTransmogs.push_back(std::make_pair(itemGUID, appearanceIndex.GetTransmogEntry(itemGUID)));
+                        }
+                    }
+
+                    auto collectionIt = playerDiscoveredTransmogs.find(playerID);
+                    cachedPlayer.collectionLoaded = collectionIt != playerDiscoveredTransmogs.end();
+                    if (cachedPlayer.collectionLoaded)
+                    {
+                        cachedPlayer.discoveredTransmogs = std::move(collectionIt->second);
+                    }
+
+                    playerCache.Insert(playerID, std::move(cachedPlayer), time(nullptr));
+                }
+
+                // Unload transmog config
+                appearanceIndex.ErasePlayer(playerID);
+                playerDiscoveredTransmogs.erase(playerID);
+                collectionIndexes.erase(playerID);
+                addonProtocols.erase(playerID);
+                clientVersions.erase(playerID);
+                versionedPlayers.erase(playerID);
+                pendingPageRequests.erase(playerID);
+                streams.erase(playerID);
+                pendingDiscoveries.erase(playerID);
+                rateLimiter.ErasePlayer(playerID);
+                playerStates.erase(playerID);
+
+                // Forget the account collection once its last character is gone
+                auto sharedIt = sharedCollections.find(collectionOwner);
+                if (sharedIt != sharedCollections.end() && sharedIt->second.expired())
+                {
+                    sharedCollections.erase(sharedIt);
+                }
+            }
+	    }
+    }
+
+    void TransmogModule::OnDeleteFromDB(uint32 playerId)
+    {
+        if (GetConfig()->enabled)
+        {
+            // Pending writes would bring back the rows we are about to delete
+            DiscardPendingWrites(playerId);
+            loadingPlayers.erase(playerId);
+            collectionRequests.erase(playerId);
+            lazyCollections.erase(playerId);
+            playerCache.Erase(playerId);
+            SetTrackedPlayer(playerId, false);
+
+		    CharacterDatabase.PExecute("DELETE FROM `custom_transmog_active` WHERE `player` = %u", playerId);
+
+            // Account wide collections are kept for the other characters of the account
+            CharacterDatabase.PExecute("DELETE FROM `custom_transmog_discovered` WHERE `player` = %u", playerId);
+            if (IsBlobStorage())
+            {
+                CharacterDatabase.PExecute("DELETE FROM `custom_transmog_collection` WHERE `player` = %u", playerId);
+            }
+
+            // Unload transmog config
+            appearanceIndex.ErasePlayer(playerId);
+            playerDiscoveredTransmogs.erase(playerId);
+            collectionIndexes.erase(playerId);
+            playerStates.erase(playerId);
+	    }
+    }
+
+    void TransmogModule::OnSetVisibleItemSlot(Player* player, uint8 slot, Item* item)
+    {
+	    if (GetConfig()->enabled)
+	    {
+		    if (player && slot < TRANSMOG_EQUIPMENT_SLOTS)
+		    {
+                const uint32 playerID = player->GetObjectGuid().GetCounter();
+                if (!IsTrackedPlayer(playerID))
+                {
+                    skippedHookCalls++;
+                    return;
+                }
+
+                TransmogPlayerState* playerState = GetPlayerState(playerID);
+                if (!playerState)
+                    return;
+
+                TransmogEquippedSlot& equippedSlot = playerState->equippedSlots[slot];
+                if (!item)
+                {
+                    equippedSlot = { 0, 0 };
+                    return;
+                }
+
+                // Resolve the appearance only when a different item lands on the slot
+                const uint32 itemGUID = item->GetObjectGuid().GetCounter();
+                if (equippedSlot.itemGUID != itemGUID)
+                {
+                    equippedSlot = { itemGUID, appearanceIndex.GetTransmogEntry(itemGUID) };
+                }
+
+                if (uint32 entry = equippedSlot.transmogEntry)
+			    {
+#if EXPANSION == 2
+                    player->SetUInt32Value(PLAYER_VISIBLE_ITEM_1_ENTRYID + item->GetSlot() * 2, entry);
+#else
+                    player->SetUInt32Value(PLAYER_VISIBLE_ITEM_1_0 + item->GetSlot() * MAX_VISIBLE_ITEM_OFFSET, entry);
+#endif
+			    }
+		    }
+	    }
+    }
+
+    void TransmogModule::OnEquipItem(Player* player, Item* item)
+    {
+        if (GetConfig()->enabled)
+        {
+            if (player && item)
+            {
+                const uint32 playerID = player->GetObjectGuid().GetCounter();
+                if (!IsTrackedPlayer(playerID))
+                {
+                    skippedHookCalls++;
+                    return;
+                }
+
+                if (TransmogPlayerState* playerState = GetPlayerState(playerID))
+                {
+                    UpdateEquippedSlot(*playerState, item);
+                }
+
+                // Don't consider items if the player has not finished loading from DB
+                if (playerDiscoveredTransmogs.find(playerID) != playerDiscoveredTransmogs.end())
+                {
+                    const uint32 itemEntry = item->GetEntry();
+                    if (IsValidTransmog(player, itemEntry))
+                    {
+                        AddDiscoveredTransmog(player, itemEntry, true, true);
+                    }
+                }
+                else
+                {
+                    // Keep the possible discovery until the lazy collection is loaded
+                    auto it = lazyCollections.find(playerID);
+                    if (it != lazyCollections.end())
+                    {
+                        const uint32 itemEntry = item->GetEntry();
+                        if (IsValidTransmog(player, itemEntry))
+                        {
+                            it->second.discoveries.push_back(itemEntry);
+                            LoadDiscoveredTransmogsIfNeeded(player, false);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void TransmogModule::OnMoveItemFromInventory(Player* player, Item* item)
+    {
+        if (GetConfig()->enabled)
+        {
+            if (player && item)
+            {
+                if (!IsTrackedPlayer(player->GetObjectGuid().GetCounter()))
+                {
+                    skippedHookCalls++;
+                    return;
+                }
+
+			    RemoveTransmog(player, item, false);
+		    }
+	    }
+    }
+
+    std::vector<ModuleChatCommand>* TransmogModule::GetCommandTable()
+    {
+        static std::vector<ModuleChatCommand> commandTable =
+        {
+            { "Handshake", std::bind(&TransmogModule::HandleHandshake, this, std::placeholders::_1, std::placeholders::_2), SEC_PLAYER },
+            { "GetTransmogStatus", std::bind(&TransmogModule::HandleTransmogStatus, this, std::placeholders::_1, std::placeholders::_2), SEC_PLAYER },
+            { "GetAvailableTransmogs", std::bind(&TransmogModule::HandleGetAvailableTransmogs, this, std::placeholders::_1, std::placeholders::_2), SEC_PLAYER },
+            { "GetAvailableTransmogsPage", std::bind(&TransmogModule::HandleGetAvailableTransmogsPage, this, std::placeholders::_1, std::placeholders::_2), SEC_PLAYER },
+            { "CalculateTransmogCost", std::bind(&TransmogModule::HandleCalculateTransmogCost, this, std::placeholders::_1, std::placeholders::_2), SEC_PLAYER },
+            { "ApplyTransmog", std::bind(&TransmogModule::HandleApplyTransmog, this, std::placeholders::_1, std::placeholders::_2), SEC_PLAYER },
+            { "Stats", std::bind(&TransmogModule::HandleTransmogStats, this, std::placeholders::_1, std::placeholders::_2), SEC_GAMEMASTER }
+        };
+
+        return &commandTable;
+    }
+
+    bool TransmogModule::HandleHandshake(WorldSession* session, const std::string& args)
+    {
+        if (GetConfig()->enabled)
+        {
+            Player* player = session->GetPlayer();
+            if (player)
+            {
+                if (!CanRunCommand(player, TRANSMOG_COMMAND_HANDSHAKE))
+                    return true;
+
+                // Use the latest protocol both sides understand
+                const uint32 clientProtocol = strtoul(args.c_str(), nullptr, 10);
+                const uint8 protocol = uint8(std::min<uint32>(std::max<uint32>(clientProtocol, TRANSMOG_PROTOCOL_TEXT), TRANSMOG_PROTOCOL_LATEST));
+                addonProtocols[player->GetObjectGuid().GetCounter()] = protocol;
+
+                TransmogAddonMessage message;
+                message << "Handshake:" << uint32(protocol);
+                SendAddOnMessage(player, GetChatCommandPrefix(), message);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    uint8 TransmogModule::GetAddonProtocol(uint32 playerID) const
+    {
+        auto it = addonProtocols.find(playerID);
+        return it != addonProtocols.end() ? it->second : uint8(TRANSMOG_PROTOCOL_TEXT);
+    }
+
+    // Chat command of each TransmogCommand and the tokens it takes, heavier work takes more
+    static const char* const TransmogCommandNames[TRANSMOG_COMMAND_COUNT] = { "Handshake", "GetTransmogStatus", "GetAvailableTransmogs", "GetAvailableTransmogsPage", "CalculateTransmogCost", "ApplyTransmog" };
+    static const uint32 TransmogCommandCosts[TRANSMOG_COMMAND_COUNT] = { 1, 1, 10, 1, 1, 2 };
+
+    bool TransmogModule::CanRunCommand(const Player* player, TransmogCommand command)
+    {
+        if (!rateLimiter.IsEnabled())
+            return true;
+
+        uint32 retryDelay = 0;
+        if (rateLimiter.Consume(player->GetObjectGuid().GetCounter(), command, TransmogCommandCosts[command], WorldTimer::getMSTime(), retryDelay))
+            return true;
+
+        // Let the addon know when to ask again instead of leaving it waiting for an answer
+        TransmogAddonMessage message;
+        message << "Busy:" << TransmogCommandNames[command] << ':' << retryDelay;
+        SendAddOnMessage(player, GetChatCommandPrefix(), message);
+        return false;
+    }
+
+    bool TransmogModule::HandleTransmogStatus(WorldSession* session, const std::string& args)
+    {
+        if (GetConfig()->enabled)
+        {
+            Player* player = session->GetPlayer();
+            if (player)
+            {
+                if (!CanRunCommand(player, TRANSMOG_COMMAND_STATUS))
+                    return true;
+
+                SendActiveTransmogs(player);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool TransmogModule::HandleGetAvailableTransmogs(WorldSession* session, const std::string& args)
+    {
+        if (GetConfig()->enabled)
+        {
+            Player* player = session->GetPlayer();
+            if (player)
+            {
+                if (!CanRunCommand(player, TRANSMOG_COMMAND_AVAILABLE))
+                    return true;
+
+                // Addons that keep the collection between sessions send the version they have
+                const uint32 playerID = player->GetObjectGuid().GetCounter();
+                if (!args.empty())
+                {
+                    clientVersions[playerID] = strtoull(args.c_str(), nullptr, 16);
+                    versionedPlayers.insert(playerID);
+                }
+
+                LoadDiscoveredTransmogsIfNeeded(player, true);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool TransmogModule::HandleGetAvailableTransmogsPage(WorldSession* session, const std::string& args)
+    {
+        if (GetConfig()->enabled)
+        {
+            Player* player = session->GetPlayer();
+            if (player)
+            {
+                if (!CanRunCommand(player, TRANSMOG_COMMAND_PAGE))
+                    return true;
+
+                TransmogPageRequest request;
+                if (!request.Parse(args))
+                    return false;
+
+                // Answer once the collection is loaded, only the last page asked matters
+                const uint32 playerID = player->GetObjectGuid().GetCounter();
+                if (playerDiscoveredTransmogs.find(playerID) == playerDiscoveredTransmogs.end())
+                {
+                    pendingPageRequests[playerID] = request;
+                    LoadDiscoveredTransmogsIfNeeded(player, false);
+                    return true;
+                }
+
+                SendTransmogPage(player, request);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool TransmogModule::HandleCalculateTransmogCost(WorldSession* session, const std::string& args)
+    {
+        if (GetConfig()->enabled)
+        {
+            Player* player = session->GetPlayer();
+            if (player)
+            {
+                if (!CanRunCommand(player, TRANSMOG_COMMAND_COST))
+                    return true;
+
+                // A malformed list costs nothing and can not be purchased
+                TransmogSlotList slots;
+                if (!slots.Parse(args))
+                {
+                    slots.Clear();
                 }
 
+                SendTransmogCost(player, slots);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool TransmogModule::HandleApplyTransmog(WorldSession* session, const std::string& args)
+    {
+        if (GetConfig()->enabled)
+        {
+            Player* player = session->GetPlayer();
+            if (player)
+            {
+                if (!CanRunCommand(player, TRANSMOG_COMMAND_APPLY))
+                    return true;
+
+                TransmogSlotList slots;
+                const bool validSlots = slots.Parse(args);
+
                 uint32 cost = 0;
                 uint32 tokenID = 0;
                 bool succeeded = false;
 
-                if (slots.size() > 0)
+                if (validSlots && !slots.empty())
                 {
                     for (auto& pair : slots)
                     {
@@ -310,61 +1057,33 @@ namespace cmangos_module
 
                 if (succeeded)
                 {
-                    for (auto& pair : slots)
-                    {
-                        const uint32 slot = pair.first;
-                        const uint32 itemID = pair.second;
-                        if (Item* slotItem = player->GetItemByPos(INVENTORY_SLOT_BAG_0, slot))
-                        {
-                            if (itemID > 0)
-                            {
-                                if (!ApplyTransmog(player, slotItem, itemID, true))
-                                {
-                                    succeeded = false;
-                                    break;
-                                }
-                            }
-                            else
-                            {
-                                if (!RemoveTransmog(player, slotItem, true))
-                                {
-                                    succeeded = false;
-                                    break;
-                                }
-                            }
-                        }
-                    }
+                    succeeded = ApplyTransmogs(player, slots, cost, tokenID);
+
+                    // Applying is one of the lazy collection triggers, the addon refreshes its lists right after
+                    LoadDiscoveredTransmogsIfNeeded(player, false);
                 }
 
                 if (succeeded)
                 {
-                    if (tokenID)
-                    {
-                        player->DestroyItemCount(tokenID, cost, true);
-                    }
-                    else
-                    {
-                        player->ModifyMoney(-(int32)cost);
-                    }
-
                     player->GetPlayerMenu();
 
-                    std::ostringstream out;
+                    TransmogAddonMessage message;
+                    message << "ApplyTransmogResult:1:";
                     bool first = true;
                     for (auto& pair : slots)
                     {
                         if (first)
                         {
-                            out << pair.first << "," << pair.second;
+                            message << pair.first << ',' << pair.second;
                             first = false;
                         }
                         else
                         {
-                            out << ":" << pair.first << "," << pair.second;
+                            message << ':' << pair.first << ',' << pair.second;
                         }
                     }
 
-                    SendAddOnMessage(player, GetChatCommandPrefix(), helper::FormatString("ApplyTransmogResult:1:%s", out.str().c_str()));
+                    SendAddOnMessage(player, GetChatCommandPrefix(), message);
                 }
                 else
                 {
@@ -375,77 +1094,251 @@ namespace cmangos_module
             }
         }
 
-        return false;
-    }
+        return false;
+    }
+
+    bool TransmogModule::HandleTransmogStats(WorldSession* session, const std::string& args)
+    {
+        if (GetConfig()->enabled)
+        {
+            ChatHandler handler(session);
+            handler.PSendSysMessage("Transmog write queue: %u pending (max %u), last flush latency %u ms (max %u ms), last flush took %u ms",
+                GetPendingWritesCount(), maxPendingWrites, lastFlushLatency, maxFlushLatency, lastFlushDuration);
+            handler.PSendSysMessage("Transmog write queue: " UI64FMTD " rows flushed in " UI64FMTD " statements", flushedRows, flushedStatements);
+            handler.PSendSysMessage("Transmog player cache: %u players cached, " UI64FMTD " hits, " UI64FMTD " misses", (uint32)playerCache.Size(), cacheHits, cacheMisses);
+            handler.PSendSysMessage("Transmog hooks: " UI64FMTD " calls skipped for untracked players", skippedHookCalls);
+            handler.PSendSysMessage("Transmog rate limit: %u players limited, throttled " UI64FMTD " handshakes, " UI64FMTD " status, " UI64FMTD " collections, " UI64FMTD " pages, " UI64FMTD " costs, " UI64FMTD " applies",
+                (uint32)rateLimiter.Size(), rateLimiter.GetThrottled(TRANSMOG_COMMAND_HANDSHAKE), rateLimiter.GetThrottled(TRANSMOG_COMMAND_STATUS), rateLimiter.GetThrottled(TRANSMOG_COMMAND_AVAILABLE),
+                rateLimiter.GetThrottled(TRANSMOG_COMMAND_PAGE), rateLimiter.GetThrottled(TRANSMOG_COMMAND_COST), rateLimiter.GetThrottled(TRANSMOG_COMMAND_APPLY));
+
+            // Characters of the same account share their collection, count it only once
+            size_t collectionsMemory = 0;
+            size_t collectionsSize = 0;
+            size_t maxCollectionMemory = 0;
+            std::unordered_set<const TransmogCollection*> countedCollections;
+            for (const auto& pair : playerDiscoveredTransmogs)
+            {
+                if (countedCollections.insert(pair.second.get()).second)
+                {
+                    const size_t collectionMemory = pair.second->GetMemoryUsage();
+                    collectionsMemory += collectionMemory;
+                    collectionsSize += pair.second->Size();
+                    maxCollectionMemory = std::max(maxCollectionMemory, collectionMemory);
+                }
+            }
+
+            const uint32 players = playerDiscoveredTransmogs.size();
+            const uint32 collections = countedCollections.size();
+            handler.PSendSysMessage("Transmog collections: %u players, %u collections, %u appearances, %u bytes (%u bytes per collection, max %u bytes)",
+                players, collections, (uint32)collectionsSize, (uint32)collectionsMemory, collections ? uint32(collectionsMemory / collections) : 0U, (uint32)maxCollectionMemory);
+            handler.PSendSysMessage("Transmog catalog: %u items, %u appearances", (uint32)catalog.Size(), catalog.GetDisplayGroupsCount());
+            handler.PSendSysMessage("Transmog responses: " UI64FMTD " buckets encoded, " UI64FMTD " buckets sent from cache, " UI64FMTD " messages (" UI64FMTD " bytes)",
+                encodedResponses, cachedResponses, sentResponseMessages, sentResponseBytes);
+            handler.PSendSysMessage("Transmog client caches: " UI64FMTD " up to date, " UI64FMTD " delta syncs, " UI64FMTD " full syncs, " UI64FMTD " pages sent", currentSyncs, deltaSyncs, fullSyncs, sentPages);
+            handler.PSendSysMessage("Transmog streams: %u players waiting, " UI64FMTD " messages paced, " UI64FMTD " streams cancelled", (uint32)streams.size(), streamedMessages, cancelledStreams);
+            handler.PSendSysMessage("Transmog discoveries: " UI64FMTD " items sent in " UI64FMTD " delta messages", coalescedDiscoveries, discoveryDeltaMessages);
+
+            if (IsBlobStorage())
+            {
+                handler.PSendSysMessage("Transmog collection blobs: " UI64FMTD " compacted, " UI64FMTD " collections migrated (" UI64FMTD " rows), migration %s",
+                    compactedCollections, migratedCollections, migratedRows, migrationFinished ? "finished" : "in progress");
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    void TransmogModule::UpdateItemAppearance(Player* player, Item* item) const
+    {
+        if (item->IsEquipped())
+	    {
+            player->SetVisibleItemSlot(item->GetSlot(), item);
+	    }
+    }
+
+    uint32 TransmogModule::GetTransmogAppearance(const Item* item) const
+    {	
+	    if (item)
+	    {
+            return appearanceIndex.GetTransmogEntry(item->GetObjectGuid().GetCounter());
+	    }
+
+	    return 0;
+    }
+
+    void TransmogModule::SetTransmogAppearance(uint32 playerID, const Item* item, uint32 transmogItemID)
+    {
+        const uint32 itemGUID = item->GetObjectGuid().GetCounter();
+        if (transmogItemID)
+        {
+            appearanceIndex.Set(itemGUID, transmogItemID, playerID);
+        }
+        else
+        {
+            appearanceIndex.Erase(itemGUID);
+        }
+
+        if (TransmogPlayerState* playerState = GetPlayerState(playerID))
+        {
+            UpdateEquippedSlot(*playerState, item);
+        }
+    }
+
+    void TransmogModule::SetTrackedPlayer(uint32 playerID, bool tracked)
+    {
+        const uint32 word = playerID >> 6;
+        if (word >= trackedPlayers.size())
+        {
+            if (!tracked)
+                return;
+
+            trackedPlayers.resize(word + 1, 0);
+        }
+
+        const uint64 bit = uint64(1) << (playerID & 63);
+        if (tracked)
+        {
+            trackedPlayers[word] |= bit;
+        }
+        else
+        {
+            trackedPlayers[word] &= ~bit;
+        }
+    }
+
+    TransmogPlayerState* TransmogModule::GetPlayerState(uint32 playerID)
+    {
+        auto it = playerStates.find(playerID);
+        return it != playerStates.end() ? &it->second : nullptr;
+    }
+
+    const TransmogPlayerState* TransmogModule::GetPlayerState(uint32 playerID) const
+    {
+        auto it = playerStates.find(playerID);
+        return it != playerStates.end() ? &it->second : nullptr;
+    }
+
+    void TransmogModule::UpdateEquippedSlot(TransmogPlayerState& playerState, const Item* item) const
+    {
+        if (item->IsEquipped() && item->GetSlot() < TRANSMOG_EQUIPMENT_SLOTS)
+        {
+            const uint32 itemGUID = item->GetObjectGuid().GetCounter();
+            playerState.equippedSlots[item->GetSlot()] = { itemGUID, appearanceIndex.GetTransmogEntry(itemGUID) };
+        }
+    }
+
+    bool TransmogModule::ApplyTransmogs(Player* player, const TransmogSlotList& slots, uint32 cost, uint32 tokenID)
+    {
+        struct SlotChange
+        {
+            Item* item;
+            uint32 previousEntry;
+            uint32 newEntry;
+        };
+
+        // Validate every slot before changing anything
+        std::vector<SlotChange> changes;
+        for (auto& pair : slots)
+        {
+            const uint32 slot = pair.first;
+            const uint32 itemID = pair.second;
+            if (Item* slotItem = player->GetItemByPos(INVENTORY_SLOT_BAG_0, slot))
+            {
+                if (itemID > 0 && !IsValidTransmog(player, itemID))
+                {
+                    return false;
+                }
+
+                changes.push_back({ slotItem, GetTransmogAppearance(slotItem), itemID });
+            }
+        }
+
+        if (changes.empty())
+            return false;
+
+        // Charge only once everything is known to succeed, nothing has been changed yet
+        if (tokenID ? !player->HasItemCount(tokenID, cost) : player->GetMoney() < cost)
+            return false;
+
+        if (tokenID)
+        {
+            player->DestroyItemCount(tokenID, cost, true);
+        }
+        else
+        {
+            player->ModifyMoney(-(int32)cost);
+        }
+
+        const uint32 playerID = player->GetObjectGuid().GetCounter();
+        for (const SlotChange& change : changes)
+        {
+            SetTransmogAppearance(playerID, change.item, change.newEntry);
+        }
 
-    void TransmogModule::UpdateItemAppearance(Player* player, Item* item) const
-    {
-        if (item->IsEquipped())
-	    {
-            player->SetVisibleItemSlot(item->GetSlot(), item);
-	    }
-    }
+        // Store all the slots and the payment in a single transaction
+        std::string replaceQuery;
+        std::string deleteQuery;
+        for (const SlotChange& change : changes)
+        {
+            const uint32 itemGUID = change.item->GetObjectGuid().GetCounter();
 
-    uint32 TransmogModule::GetTransmogAppearance(const Item* item) const
-    {	
-	    if (item)
-	    {
-		    const ObjectGuid itemGUID = item->GetObjectGuid();
-            const auto itr = dataMap.find(itemGUID);
-            if (itr == dataMap.end()) return 0;
-            const auto itr2 = entryMap.find(itr->second);
-            if (itr2 == entryMap.end()) return 0;
-            const auto itr3 = itr2->second.find(itemGUID);
-            if (itr3 == itr2->second.end()) return 0;
-            return itr3->second;
-	    }
+            // The transaction supersedes the queued write of the items it writes, the others keep theirs
+            if (change.newEntry)
+            {
+                pendingActiveTransmogs.erase(itemGUID);
+                replaceQuery += replaceQuery.empty() ? "REPLACE INTO `custom_transmog_active` (`item_guid`, `transmog_entry`, `player`) VALUES " : ",";
+                replaceQuery += helper::FormatString("(%u, %u, %u)", itemGUID, change.newEntry, playerID);
+            }
+            else if (change.previousEntry)
+            {
+                pendingActiveTransmogs.erase(itemGUID);
+                deleteQuery += deleteQuery.empty() ? "DELETE FROM `custom_transmog_active` WHERE `item_guid` IN (" : ",";
+                deleteQuery += std::to_string(itemGUID);
+            }
+        }
 
-	    return 0;
-    }
+        CharacterDatabase.BeginTransaction();
 
-    bool TransmogModule::ApplyTransmog(Player* player, Item* item, uint32 transmogItemID, bool updateAppearance)
-    {
-        if (player && item)
+        if (!replaceQuery.empty())
         {
-            if (IsValidTransmog(player, transmogItemID))
-            {
-                const ObjectGuid itemGUID = item->GetObjectGuid();
-                const uint32 playerID = player->GetObjectGuid().GetCounter();
-
-                entryMap[playerID][itemGUID] = transmogItemID;
-                dataMap[itemGUID] = playerID;
+            CharacterDatabase.Execute(replaceQuery.c_str());
+        }
 
-                CharacterDatabase.PExecute("REPLACE INTO `custom_transmog_active` (`item_guid`, `transmog_entry`, `player`) VALUES (%u, %u, %u)", itemGUID.GetCounter(), transmogItemID, playerID);
+        if (!deleteQuery.empty())
+        {
+            deleteQuery += ")";
+            CharacterDatabase.Execute(deleteQuery.c_str());
+        }
 
-                if (updateAppearance)
-                {
-                    UpdateItemAppearance(player, item);
-                }
+        player->SaveInventoryAndGoldToDB();
+        CharacterDatabase.CommitTransaction();
 
-                return true;
-            }
+        for (const SlotChange& change : changes)
+        {
+            UpdateItemAppearance(player, change.item);
         }
 
-        return false;
+        return true;
     }
 
     bool TransmogModule::RemoveTransmog(Player* player, Item* item, bool updateAppearance)
     {
         if (player && item)
         {
-            const ObjectGuid itemGUID = item->GetObjectGuid();
-            if (dataMap.find(itemGUID) != dataMap.end())
+            // Items without transmog have nothing stored in the database
+            const uint32 playerID = player->GetObjectGuid().GetCounter();
+            const uint32 itemGUID = item->GetObjectGuid().GetCounter();
+            if (appearanceIndex.Erase(itemGUID))
             {
-                if (entryMap.find(dataMap[itemGUID]) != entryMap.end())
+                QueueActiveTransmog(playerID, itemGUID, 0);
+
+                if (TransmogPlayerState* playerState = GetPlayerState(playerID))
                 {
-                    entryMap[dataMap[itemGUID]].erase(itemGUID);
+                    UpdateEquippedSlot(*playerState, item);
                 }
-
-                dataMap.erase(itemGUID);
             }
 
-            CharacterDatabase.PExecute("DELETE FROM `custom_transmog_active` WHERE `item_guid` = %u", itemGUID.GetCounter());
-
             if (updateAppearance)
             {
                 UpdateItemAppearance(player, item);
@@ -469,29 +1362,30 @@ namespace cmangos_module
         {
             if (equipped)
             {
-                for (uint8 slot = EQUIPMENT_SLOT_START; slot < EQUIPMENT_SLOT_END; ++slot)
+                if (const TransmogPlayerState* playerState = GetPlayerState(player->GetObjectGuid().GetCounter()))
                 {
-                    if (Item* item = player->GetItemByPos(INVENTORY_SLOT_BAG_0, slot))
+                    for (uint8 slot = EQUIPMENT_SLOT_START; slot < EQUIPMENT_SLOT_END; ++slot)
                     {
-                        uint32 transmogItemEntry = GetTransmogAppearance(item);
-                        if (transmogItemEntry != 0)
+                        const TransmogEquippedSlot& equippedSlot = playerState->equippedSlots[slot];
+                        if (equippedSlot.transmogEntry != 0)
                         {
-                            transmogrifiedItems.push_back(std::make_pair(item, transmogItemEntry));
+                            if (Item* item = player->GetItemByPos(INVENTORY_SLOT_BAG_0, slot))
+                            {
+                                transmogrifiedItems.push_back(std::make_pair(item, equippedSlot.transmogEntry));
+                            }
                         }
                     }
                 }
             }
             else
             {
-                auto playerTransmogsIt = entryMap.find(player->GetObjectGuid());
-                if (playerTransmogsIt != entryMap.end())
+                if (const std::vector<uint32>* itemGUIDs = appearanceIndex.GetPlayerItems(player->GetObjectGuid().GetCounter()))
                 {
-                    const auto& playerTransmogs = playerTransmogsIt->second;
-                    for (const auto it : playerTransmogs)
+                    for (const uint32 itemGUID : *itemGUIDs)
                     {
-                        if (Item* item = player->GetItemByGuid(it.first))
+                        if (Item* item = player->GetItemByGuid(ObjectGuid(HIGHGUID_ITEM, itemGUID)))
                         {
-                            transmogrifiedItems.push_back(std::make_pair(item, it.second));
+                            transmogrifiedItems.push_back(std::make_pair(item, appearanceIndex.GetTransmogEntry(itemGUID)));
                         }
                     }
                 }
@@ -501,365 +1395,788 @@ namespace cmangos_module
         return transmogrifiedItems;
     }
 
-    std::vector<uint8> GetWeaponAvailableForClass(uint8 playerClass)
+    bool TransmogModule::IsValidTransmog(const Player* player, uint32 itemEntry) const
+    {
+        const TransmogCatalogEntry* entry = catalog.Find(itemEntry);
+        return player && entry && catalog.CanUse(*entry, player);
+    }
+
+    void TransmogModule::LoadActiveTransmogs(Player* player, const std::vector<std::pair<uint32, uint32>>& activeTransmogs)
     {
-        std::map<uint8, std::vector<uint8>> weaponPerClass =
+        const uint32 playerID = player->GetObjectGuid().GetCounter();
+        appearanceIndex.ErasePlayer(playerID);
+
+        TransmogPlayerState& playerState = playerStates[playerID];
+        playerState = TransmogPlayerState();
+
+        for (const auto& pair : activeTransmogs)
         {
-            { CLASS_WARRIOR, { ITEM_SUBCLASS_WEAPON_AXE, ITEM_SUBCLASS_WEAPON_AXE2, ITEM_SUBCLASS_WEAPON_BOW, ITEM_SUBCLASS_WEAPON_GUN, ITEM_SUBCLASS_WEAPON_MACE, ITEM_SUBCLASS_WEAPON_MACE2, ITEM_SUBCLASS_WEAPON_POLEARM, ITEM_SUBCLASS_WEAPON_SWORD, ITEM_SUBCLASS_WEAPON_SWORD2, ITEM_SUBCLASS_WEAPON_STAFF, ITEM_SUBCLASS_WEAPON_FIST, ITEM_SUBCLASS_WEAPON_DAGGER, ITEM_SUBCLASS_WEAPON_CROSSBOW } },
-            { CLASS_PALADIN, { ITEM_SUBCLASS_WEAPON_AXE, ITEM_SUBCLASS_WEAPON_AXE2, ITEM_SUBCLASS_WEAPON_MACE, ITEM_SUBCLASS_WEAPON_MACE2, ITEM_SUBCLASS_WEAPON_POLEARM, ITEM_SUBCLASS_WEAPON_SWORD, ITEM_SUBCLASS_WEAPON_SWORD2 } },
-            { CLASS_HUNTER, { ITEM_SUBCLASS_WEAPON_AXE, ITEM_SUBCLASS_WEAPON_AXE2, ITEM_SUBCLASS_WEAPON_BOW, ITEM_SUBCLASS_WEAPON_GUN, ITEM_SUBCLASS_WEAPON_POLEARM, ITEM_SUBCLASS_WEAPON_SWORD, ITEM_SUBCLASS_WEAPON_SWORD2, ITEM_SUBCLASS_WEAPON_STAFF, ITEM_SUBCLASS_WEAPON_FIST, ITEM_SUBCLASS_WEAPON_DAGGER, ITEM_SUBCLASS_WEAPON_CROSSBOW } },
-            { CLASS_ROGUE, { ITEM_SUBCLASS_WEAPON_AXE, ITEM_SUBCLASS_WEAPON_BOW, ITEM_SUBCLASS_WEAPON_GUN, ITEM_SUBCLASS_WEAPON_MACE, ITEM_SUBCLASS_WEAPON_SWORD, ITEM_SUBCLASS_WEAPON_FIST, ITEM_SUBCLASS_WEAPON_DAGGER, ITEM_SUBCLASS_WEAPON_CROSSBOW } },
-            { CLASS_PRIEST, { ITEM_SUBCLASS_WEAPON_MACE, ITEM_SUBCLASS_WEAPON_STAFF, ITEM_SUBCLASS_WEAPON_DAGGER, ITEM_SUBCLASS_WEAPON_WAND } },
-#if EXPANSION == 2
-            { CLASS_DEATH_KNIGHT, { ITEM_SUBCLASS_WEAPON_AXE, ITEM_SUBCLASS_WEAPON_AXE2, ITEM_SUBCLASS_WEAPON_MACE, ITEM_SUBCLASS_WEAPON_MACE2, ITEM_SUBCLASS_WEAPON_POLEARM, ITEM_SUBCLASS_WEAPON_SWORD, ITEM_SUBCLASS_WEAPON_SWORD2 } },
-#endif
-            { CLASS_SHAMAN, { ITEM_SUBCLASS_WEAPON_AXE, ITEM_SUBCLASS_WEAPON_AXE2, ITEM_SUBCLASS_WEAPON_MACE, ITEM_SUBCLASS_WEAPON_MACE2, ITEM_SUBCLASS_WEAPON_STAFF, ITEM_SUBCLASS_WEAPON_FIST, ITEM_SUBCLASS_WEAPON_DAGGER } },
-            { CLASS_MAGE, { ITEM_SUBCLASS_WEAPON_SWORD, ITEM_SUBCLASS_WEAPON_STAFF, ITEM_SUBCLASS_WEAPON_DAGGER, ITEM_SUBCLASS_WEAPON_WAND } },
-            { CLASS_WARLOCK, { ITEM_SUBCLASS_WEAPON_SWORD, ITEM_SUBCLASS_WEAPON_STAFF, ITEM_SUBCLASS_WEAPON_DAGGER, ITEM_SUBCLASS_WEAPON_WAND } },
-            { CLASS_DRUID, { ITEM_SUBCLASS_WEAPON_MACE, ITEM_SUBCLASS_WEAPON_POLEARM, ITEM_SUBCLASS_WEAPON_STAFF, ITEM_SUBCLASS_WEAPON_FIST, ITEM_SUBCLASS_WEAPON_DAGGER } },
-        };
+            const uint32 itemGUID = pair.first;
+            const uint32 transmogEntry = pair.second;
+            if (catalog.Find(transmogEntry))
+            {
+                appearanceIndex.Set(itemGUID, transmogEntry, playerID);
+            }
+            else if (!sObjectMgr.GetItemPrototype(transmogEntry))
+            {
+                // Only the transmog of this item goes away, the item may come back with the database
+                sLog.outError("Item entry (Entry: %u, player ID: %u) does not exist, removing its transmog from item %u.", transmogEntry, playerID, itemGUID);
+                CharacterDatabase.PExecute("DELETE FROM `custom_transmog_active` WHERE `item_guid` = %u AND `player` = %u", itemGUID, playerID);
+            }
+            else
+            {
+                // The item still exists but is no longer a valid transmog, keep the row in case the rules change back
+                sLog.outError("Item entry (Entry: %u, player ID: %u) can not be used as a transmog, ignoring.", transmogEntry, playerID);
+            }
+        }
 
-        return weaponPerClass[playerClass];
+        // Reload the item visuals
+        for (uint8 slot = EQUIPMENT_SLOT_START; slot < EQUIPMENT_SLOT_END; ++slot)
+        {
+            if (Item* item = player->GetItemByPos(INVENTORY_SLOT_BAG_0, slot))
+            {
+                UpdateEquippedSlot(playerState, item);
+                if (playerState.equippedSlots[slot].transmogEntry)
+                {
+                    UpdateItemAppearance(player, item);
+                }
+            }
+        }
     }
 
-    std::vector<uint8> GetArmorAvailableForClass(uint8 playerClass)
+    void TransmogModule::SendActiveTransmogs(const Player* player)
     {
-        std::map<uint8, std::vector<uint8>> armorPerClass =
+        // The equipped slots already hold the status snapshot
+        uint32 amount = 0;
+        TransmogAddonMessage slots;
+        if (const TransmogPlayerState* playerState = GetPlayerState(player->GetObjectGuid().GetCounter()))
         {
-            { CLASS_WARRIOR, { ITEM_SUBCLASS_ARMOR_CLOTH, ITEM_SUBCLASS_ARMOR_LEATHER, ITEM_SUBCLASS_ARMOR_MAIL, ITEM_SUBCLASS_ARMOR_PLATE, ITEM_SUBCLASS_ARMOR_SHIELD } },
-            { CLASS_PALADIN, { ITEM_SUBCLASS_ARMOR_CLOTH, ITEM_SUBCLASS_ARMOR_LEATHER, ITEM_SUBCLASS_ARMOR_MAIL, ITEM_SUBCLASS_ARMOR_PLATE, ITEM_SUBCLASS_ARMOR_SHIELD } },
-            { CLASS_HUNTER, { ITEM_SUBCLASS_ARMOR_CLOTH, ITEM_SUBCLASS_ARMOR_LEATHER, ITEM_SUBCLASS_ARMOR_MAIL } },
-            { CLASS_ROGUE, { ITEM_SUBCLASS_ARMOR_CLOTH, ITEM_SUBCLASS_ARMOR_LEATHER } },
-            { CLASS_PRIEST, { ITEM_SUBCLASS_ARMOR_CLOTH } },
-#if EXPANSION == 2
-            { CLASS_DEATH_KNIGHT, { ITEM_SUBCLASS_ARMOR_CLOTH, ITEM_SUBCLASS_ARMOR_LEATHER, ITEM_SUBCLASS_ARMOR_MAIL, ITEM_SUBCLASS_ARMOR_PLATE } },
-#endif
-            { CLASS_SHAMAN, { ITEM_SUBCLASS_ARMOR_CLOTH, ITEM_SUBCLASS_ARMOR_LEATHER, ITEM_SUBCLASS_ARMOR_MAIL } },
-            { CLASS_MAGE, { ITEM_SUBCLASS_ARMOR_CLOTH } },
-            { CLASS_WARLOCK, { ITEM_SUBCLASS_ARMOR_CLOTH } },
-            { CLASS_DRUID, { ITEM_SUBCLASS_ARMOR_CLOTH, ITEM_SUBCLASS_ARMOR_LEATHER } },
-        };
+            for (uint8 slot = EQUIPMENT_SLOT_START; slot < EQUIPMENT_SLOT_END; ++slot)
+            {
+                const uint32 transmogEntry = playerState->equippedSlots[slot].transmogEntry;
+                if (transmogEntry != 0)
+                {
+                    slots << (amount == 0 ? "" : ":") << uint32(slot) << ',' << transmogEntry;
+                    amount++;
+                }
+            }
+        }
 
-        return armorPerClass[playerClass];
+        if (amount > 0)
+        {
+            TransmogAddonMessage message;
+            message << "TransmogStatus:" << amount << ':' << slots.c_str();
+            SendAddOnMessage(player, GetChatCommandPrefix(), message);
+        }
+        else
+        {
+            SendAddOnMessage(player, GetChatCommandPrefix(), "TransmogStatus:0");
+        }
     }
 
-    bool TransmogModule::IsValidTransmog(const Player* player, const ItemPrototype* itemPrototype) const
+    void TransmogModule::LoadDiscoveredTransmogs(const Player* player, const std::vector<uint32>& itemEntries)
     {
-        if (player && itemPrototype)
+        if (player)
         {
-            if (itemPrototype->Class == ITEM_CLASS_WEAPON || itemPrototype->Class == ITEM_CLASS_ARMOR)
+            const uint32 playerID = player->GetObjectGuid().GetCounter();
+            const uint32 collectionOwner = GetCollectionOwner(player);
+            std::shared_ptr<TransmogCollection> discoveredTransmogs = std::make_shared<TransmogCollection>();
+            playerDiscoveredTransmogs[playerID] = discoveredTransmogs;
+            collectionIndexes.erase(playerID);
+            if (GetConfig()->accountWide)
+            {
+                sharedCollections[collectionOwner] = discoveredTransmogs;
+            }
+
+            if (!itemEntries.empty())
             {
-                // Class/race requirement check
-                if ((itemPrototype->AllowableClass & player->getClassMask()) == 0 ||
-                    (itemPrototype->AllowableRace & player->getRaceMask()) == 0)
+                for (const uint32 itemEntry : itemEntries)
                 {
-                    return false;
+                    // The other characters of the account may use items this one can't
+                    const TransmogCatalogEntry* entry = GetConfig()->accountWide ? catalog.Find(itemEntry) : nullptr;
+                    if (entry)
+                    {
+                        discoveredTransmogs->Add(catalog.GetIndex(*entry));
+                    }
+                    else if (!GetConfig()->accountWide && IsValidTransmog(player, itemEntry))
+                    {
+                        AddDiscoveredTransmog(player, itemEntry, false, false);
+                    }
+                    else
+                    {
+                        // Whatever the storage, unusable entries are only skipped in memory and stay in the database
+                        // (rows or blob) as they may be usable again once the item data or the rules change
+                        sLog.outError("Item entry (Entry: %u, collection owner: %u) can not be used as a transmog, ignoring.", itemEntry, collectionOwner);
+                    }
+                }
+
+                // Only the items discovered from now on are needed to update the client caches
+                discoveredTransmogs->StartHistory();
+            }
+            else
+            {
+                // Calculate all available transmog from the items in the inventory
+                auto CheckTransmogItem = [&](Item* inventoryItem)
+                {
+                    const uint32 itemEntry = inventoryItem->GetEntry();
+                    if (IsValidTransmog(player, itemEntry))
+                    {
+                        AddDiscoveredTransmog(player, itemEntry, false, true);
+                    }
+                };
+
+                helper::ForEachEquippedItem(player, CheckTransmogItem);
+            }
+        }
+    }
+
+    void TransmogModule::AddDiscoveredTransmog(const Player* player, uint32 itemEntry, bool sendToClient, bool addToDB)
+    {
+        const uint32 playerID = player->GetObjectGuid().GetCounter();
+        auto it = playerDiscoveredTransmogs.find(playerID);
+        if (it != playerDiscoveredTransmogs.end())
+        {
+            TransmogCollection& availableTransmogs = *it->second;
+            const TransmogCatalogEntry* entry = catalog.Find(itemEntry);
+            if (entry && !availableTransmogs.Contains(catalog.GetIndex(*entry)))
+            {
+                // Account wide collections keep every item as the other characters may not be able to use the known ones
+                const bool newAppearance = !HasDiscoveredAppearance(availableTransmogs, *entry, player);
+                if (newAppearance || GetConfig()->accountWide)
+                {
+                    if (addToDB)
+                    {
+                        QueueDiscoveredTransmog(playerID, GetCollectionOwner(player), entry->itemID);
+                    }
+
+                    // Keep the index of the collection up to date instead of building it again
+                    const uint8 playerFlags = catalog.GetPlayerFlags(player);
+                    auto indexIt = collectionIndexes.find(playerID);
+                    const bool updateIndex = indexIt != collectionIndexes.end() && indexIt->second.IsBuilt(availableTransmogs.Size(), playerFlags);
+
+                    availableTransmogs.Add(catalog.GetIndex(*entry));
+
+                    if (updateIndex)
+                    {
+                        if (newAppearance)
+                        {
+                            AddToCollectionIndex(*entry, playerFlags, indexIt->second);
+                        }
+
+                        indexIt->second.SetBuilt(availableTransmogs.Size(), playerFlags);
+                    }
+
+                    if (sendToClient && newAppearance)
+                    {
+                        // Send message to client addon when new item has been discovered
+                        TransmogAddonMessage message;
+                        message << "NewTransmog:" << entry->itemID;
+                        SendAddOnMessage(player, GetChatCommandPrefix(), message);
+
+                        // Refresh the client addon available transmogs, addons that merge the new items
+                        // get everything discovered during this world update at once
+                        if (GetAddonProtocol(playerID) >= TRANSMOG_PROTOCOL_DELTA)
+                        {
+                            pendingDiscoveries[playerID].push_back(catalog.GetIndex(*entry));
+                        }
+                        else
+                        {
+                            const uint32 slotMask = catalog.GetSlotMask(*entry, catalog.GetPlayerFlags(player));
+                            for (uint8 slot = EQUIPMENT_SLOT_START; slot < EQUIPMENT_SLOT_END; ++slot)
+                            {
+                                if (slotMask & (1U << slot))
+                                {
+                                    QueueCollectionBucket(player, slot, entry->itemClass + entry->itemSubclass);
+                                }
+                            }
+                        }
+                    }
+
+                    // Keep the version stored by the client addon in step (sent with the pending discoveries if any)
+                    if (sendToClient && versionedPlayers.find(playerID) != versionedPlayers.end() && pendingDiscoveries.find(playerID) == pendingDiscoveries.end())
+                    {
+                        QueueCollectionVersion(player);
+                    }
                 }
+            }
+        }
+    }
+
+    bool TransmogModule::HasDiscoveredAppearance(const TransmogCollection& collection, const TransmogCatalogEntry& entry, const Player* player) const
+    {
+        // Only one item per display id is kept in the collection
+        uint32 amount = 0;
+        const uint32* indexes = catalog.GetDisplayGroupItems(entry.displayGroup, amount);
+        for (uint32 i = 0; i < amount; ++i)
+        {
+            if (collection.Contains(indexes[i]) && catalog.CanUse(catalog.GetEntry(indexes[i]), player))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void TransmogModule::SendDiscoveredTransmogs(const Player* player, int8 slot, int8 itemClass, int8 itemSubclass)
+    {
+        TransmogCollectionIndex* collectionIndex = GetCollectionIndex(player);
+        if (!collectionIndex)
+            return;
+
+        const uint8 firstSlot = slot >= 0 ? slot : EQUIPMENT_SLOT_START;
+        const uint8 lastSlot = slot >= 0 ? slot + 1 : EQUIPMENT_SLOT_END;
+        for (uint8 itemSlot = firstSlot; itemSlot < lastSlot; ++itemSlot)
+        {
+            for (auto& bucketIt : collectionIndex->GetSlotBuckets(itemSlot))
+            {
+                // Buckets are sorted by item class + item subclass
+                const uint32 transmogItemClass = bucketIt.first;
+                if (itemClass >= 0 && itemSubclass >= 0 && transmogItemClass != uint32(itemClass + itemSubclass))
+                    continue;
+
+                QueueCollectionBucket(player, itemSlot, transmogItemClass);
+            }
+        }
+    }
+
+    void TransmogModule::SyncDiscoveredTransmogs(const Player* player)
+    {
+        // The client asked again, drop what was still queued for it (the new items are sent again too)
+        const uint32 playerID = player->GetObjectGuid().GetCounter();
+        CancelStream(playerID);
+        pendingDiscoveries.erase(playerID);
+
+        auto versionIt = clientVersions.find(playerID);
+        if (versionIt == clientVersions.end())
+        {
+            SendDiscoveredTransmogs(player);
+            return;
+        }
+
+        const uint64 clientVersion = versionIt->second;
+        clientVersions.erase(versionIt);
+
+        auto it = playerDiscoveredTransmogs.find(playerID);
+        TransmogCollectionIndex* collectionIndex = GetCollectionIndex(player);
+        if (it == playerDiscoveredTransmogs.end() || !collectionIndex)
+            return;
+
+        const TransmogCollection& collection = *it->second;
+        const uint8 playerFlags = catalog.GetPlayerFlags(player);
+        if (GetCollectionVersion(collection.GetHash(), playerFlags) == clientVersion)
+        {
+            QueueAddonMessage(player, "TransmogSync:current");
+            QueueCollectionVersion(player);
+            currentSyncs++;
+            return;
+        }
+
+        // Look for the point of the history the client stopped at
+        const std::vector<uint32>& history = collection.GetHistory();
+        uint64 hash = collection.GetHistoryBaseHash();
+        size_t syncedPositions = 0;
+        while (syncedPositions < history.size() && GetCollectionVersion(hash, playerFlags) != clientVersion)
+        {
+            hash += TransmogCollection::HashPosition(history[syncedPositions++]);
+        }
 
-                // Valid for class check
-                const uint8 playerClass = player->getClass();
-                std::vector<uint8> itemTypeAvailable;
-                if (itemPrototype->Class == ITEM_CLASS_WEAPON)
+        if (syncedPositions < history.size())
+        {
+            // Send again the buckets that got the items the client is missing
+            std::set<std::pair<uint8, uint32>> changedBuckets;
+            for (size_t i = syncedPositions; i < history.size(); ++i)
+            {
+                const TransmogCatalogEntry& entry = catalog.GetEntry(history[i]);
+                const uint32 slotMask = catalog.GetSlotMask(entry, playerFlags);
+                for (uint8 slot = EQUIPMENT_SLOT_START; slot < EQUIPMENT_SLOT_END; ++slot)
                 {
-                    itemTypeAvailable = GetWeaponAvailableForClass(playerClass);
+                    if (slotMask & (1U << slot))
+                    {
+                        changedBuckets.insert(std::make_pair(slot, entry.itemClass + entry.itemSubclass));
+                    }
                 }
-                else if (itemPrototype->Class == ITEM_CLASS_ARMOR)
+            }
+
+            QueueAddonMessage(player, "TransmogSync:delta");
+            for (const auto& changedBucket : changedBuckets)
+            {
+                std::map<uint32, TransmogIndexBucket>& buckets = collectionIndex->GetSlotBuckets(changedBucket.first);
+                if (buckets.find(changedBucket.second) != buckets.end())
                 {
-                    itemTypeAvailable = GetArmorAvailableForClass(playerClass);
+                    QueueCollectionBucket(player, changedBucket.first, changedBucket.second);
                 }
+            }
+
+            deltaSyncs++;
+        }
+        else
+        {
+            // Unknown or too old version, the client drops what it has
+            QueueAddonMessage(player, "TransmogSync:full");
+            SendDiscoveredTransmogs(player);
+            fullSyncs++;
+        }
+
+        QueueCollectionVersion(player);
+    }
+
+    void TransmogModule::SendCollectionVersion(const Player* player)
+    {
+        auto it = playerDiscoveredTransmogs.find(player->GetObjectGuid().GetCounter());
+        if (it != playerDiscoveredTransmogs.end())
+        {
+            const uint64 version = GetCollectionVersion(it->second->GetHash(), catalog.GetPlayerFlags(player));
+            TransmogAddonMessage message;
+            message << "TransmogSync:version:";
+            message.AppendHex(uint32(version >> 32));
+            message.AppendHex(uint32(version));
+            SendAddOnMessage(player, GetChatCommandPrefix(), message);
+        }
+    }
+
+    uint64 TransmogModule::GetCollectionVersion(uint64 collectionHash, uint8 playerFlags) const
+    {
+        // What the client sees also depends on the catalog and the off hand capabilities of the player
+        return collectionHash ^ (catalogChecksum + TransmogCollection::HashPosition(playerFlags));
+    }
+
+    TransmogCollectionIndex* TransmogModule::GetCollectionIndex(const Player* player)
+    {
+        const uint32 playerID = player->GetObjectGuid().GetCounter();
+        auto it = playerDiscoveredTransmogs.find(playerID);
+        if (it == playerDiscoveredTransmogs.end())
+            return nullptr;
+
+        const uint8 playerFlags = catalog.GetPlayerFlags(player);
+        TransmogCollectionIndex& collectionIndex = collectionIndexes[playerID];
+        if (!collectionIndex.IsBuilt(it->second->Size(), playerFlags))
+        {
+            BuildCollectionIndex(player, *it->second, playerFlags, collectionIndex);
+        }
+
+        return &collectionIndex;
+    }
+
+    bool TransmogModule::SendCollectionBucket(const Player* player, uint8 slot, uint32 transmogItemClass, uint32& messageIndex, uint32& budget)
+    {
+        // The index is looked up again every time as it may have been rebuilt since the last update
+        TransmogCollectionIndex* collectionIndex = GetCollectionIndex(player);
+        if (!collectionIndex)
+            return true;
+
+        std::map<uint32, TransmogIndexBucket>& buckets = collectionIndex->GetSlotBuckets(slot);
+        auto bucketIt = buckets.find(transmogItemClass);
+        if (bucketIt == buckets.end())
+            return true;
+
+        const uint8 protocol = GetAddonProtocol(player->GetObjectGuid().GetCounter());
+
+        uint32 equippedItemID = 0;
+        if (Item* item = player->GetItemByPos(INVENTORY_SLOT_BAG_0, slot))
+        {
+            equippedItemID = item->GetEntry();
+        }
+
+        bool encoded = false;
+        const std::vector<std::string>& messages = collectionIndex->GetMessages(catalog, slot, transmogItemClass, bucketIt->second, equippedItemID, protocol, TRANSMOG_ADDON_TEXT_LIMIT, encoded);
+        if (encoded)
+        {
+            // The first message makes the client start the list again
+            messageIndex = 0;
+            encodedResponses++;
+        }
+        else if (messageIndex == 0)
+        {
+            cachedResponses++;
+        }
+
+        while (messageIndex < messages.size() && budget > 0)
+        {
+            SendAddonResponse(player, messages[messageIndex++]);
+            budget--;
+        }
+
+        return messageIndex >= messages.size();
+    }
+
+    void TransmogModule::SendAddonResponse(const Player* player, const std::string& message)
+    {
+        SendAddOnMessage(player, GetChatCommandPrefix(), message);
+        sentResponseMessages++;
+        sentResponseBytes += message.size();
+    }
+
+    void TransmogModule::SendAddonResponse(const Player* player, const TransmogAddonMessage& message)
+    {
+        SendAddOnMessage(player, GetChatCommandPrefix(), message);
+        sentResponseMessages++;
+        sentResponseBytes += message.size();
+    }
+
+    void TransmogModule::QueueAddonMessage(const Player* player, const std::string& message)
+    {
+        TransmogStreamEntry entry;
+        entry.type = TRANSMOG_STREAM_MESSAGE;
+        entry.message = message;
+        streams[player->GetObjectGuid().GetCounter()].entries.push_back(std::move(entry));
+        SendStreamIfNotPaced(player);
+    }
 
-                for (uint8 subclassAvailable : itemTypeAvailable)
-                {
-                    if (itemPrototype->SubClass == subclassAvailable)
-                    {
-                        return true;
-                    }
-                }
-            }
+    void TransmogModule::QueueCollectionBucket(const Player* player, uint8 slot, uint32 transmogItemClass)
+    {
+        TransmogStream& stream = streams[player->GetObjectGuid().GetCounter()];
+
+        // A bucket waiting in the queue already sends the latest items, unless it is halfway sent
+        if (IsBucketQueued(stream, slot, transmogItemClass, stream.messageIndex > 0 ? 1 : 0))
+            return;
+
+        TransmogStreamEntry entry;
+        entry.type = TRANSMOG_STREAM_BUCKET;
+        entry.slot = slot;
+        entry.itemClass = transmogItemClass;
+        stream.entries.push_back(std::move(entry));
+        SendStreamIfNotPaced(player);
+    }
+
+    bool TransmogModule::IsBucketQueued(const TransmogStream& stream, uint8 slot, uint32 transmogItemClass, size_t firstEntry) const
+    {
+        for (size_t i = firstEntry; i < stream.entries.size(); ++i)
+        {
+            const TransmogStreamEntry& entry = stream.entries[i];
+            if (entry.type == TRANSMOG_STREAM_BUCKET && entry.slot == slot && entry.itemClass == transmogItemClass)
+                return true;
         }
 
         return false;
     }
 
-    bool TransmogModule::IsValidTransmog(const Player* player, uint32 itemEntry) const
+    void TransmogModule::QueueCollectionVersion(const Player* player)
     {
-        return IsValidTransmog(player, sObjectMgr.GetItemPrototype(itemEntry));
+        TransmogStreamEntry entry;
+        entry.type = TRANSMOG_STREAM_VERSION;
+        streams[player->GetObjectGuid().GetCounter()].entries.push_back(std::move(entry));
+        SendStreamIfNotPaced(player);
     }
 
-    void TransmogModule::LoadActiveTransmogs(Player* player)
+    void TransmogModule::SendStreamIfNotPaced(const Player* player)
     {
-        const uint32 playerID = player->GetObjectGuid().GetCounter();
-        entryMap.erase(playerID);
-
-        auto result = CharacterDatabase.PQuery("SELECT `item_guid`, `transmog_entry` FROM `custom_transmog_active` WHERE `player` = %u", playerID);
-        if (result)
+        if (GetConfig()->streamMessagesPerPlayer == 0)
         {
-            do
+            auto it = streams.find(player->GetObjectGuid().GetCounter());
+            if (it != streams.end())
             {
-                Field* fields = result->Fetch();
-                const ObjectGuid itemGUID = ObjectGuid(HIGHGUID_ITEM, (fields[0].GetUInt32()));
-                const uint32 transmogEntry = fields[1].GetUInt32();
-                if (sObjectMgr.GetItemPrototype(transmogEntry))
-                {
-                    dataMap[itemGUID] = playerID;
-                    entryMap[playerID][itemGUID] = transmogEntry;
-                }
-                else
-                {
-                    sLog.outError("Item entry (Entry: %u, player ID: %u) does not exist, ignoring.", transmogEntry, playerID);
-                    CharacterDatabase.PExecute("DELETE FROM `custom_transmog_active` WHERE `transmog_entry` = %u", transmogEntry);
-                }
-            } 
-            while (result->NextRow());
-
-            // Reload the item visuals
-            for (uint8 slot = EQUIPMENT_SLOT_START; slot < EQUIPMENT_SLOT_END; ++slot)
-            {
-                if (Item* item = player->GetItemByPos(INVENTORY_SLOT_BAG_0, slot))
-                {
-                    UpdateItemAppearance(player, item);
-                }
+                uint32 budget = UINT32_MAX;
+                SendStream(player, it->second, budget);
+                streams.erase(it);
             }
         }
     }
 
-    void TransmogModule::SendActiveTransmogs(const Player* player)
+    void TransmogModule::SendStream(const Player* player, TransmogStream& stream, uint32& budget)
     {
-        const auto transmogItems = GetTransmogrifiedItems(player, true);
-        if (!transmogItems.empty())
+        while (!stream.entries.empty() && budget > 0)
         {
-            bool first = true;
-            std::ostringstream out;
-            for (const auto& pair : transmogItems)
+            const TransmogStreamEntry& entry = stream.entries.front();
+            if (entry.type == TRANSMOG_STREAM_BUCKET)
+            {
+                // Continue with the same bucket on the next update
+                if (!SendCollectionBucket(player, entry.slot, entry.itemClass, stream.messageIndex, budget))
+                    break;
+            }
+            else
             {
-                const uint32 itemSlot = pair.first->GetSlot();
-                const uint32 transmogEntry = pair.second;
-                if (first)
+                if (entry.type == TRANSMOG_STREAM_VERSION)
                 {
-                    first = false;
-                    out << helper::FormatString("%u,%u", itemSlot, transmogEntry);
+                    SendCollectionVersion(player);
                 }
                 else
                 {
-                    out << helper::FormatString(":%u,%u", itemSlot, transmogEntry);
+                    SendAddonResponse(player, entry.message);
                 }
+
+                budget--;
             }
 
-            SendAddOnMessage(player, GetChatCommandPrefix(), helper::FormatString("TransmogStatus:%u:%s", transmogItems.size(), out.str().c_str()));
+            stream.entries.pop_front();
+            stream.messageIndex = 0;
         }
-        else
+    }
+
+    void TransmogModule::CancelStream(uint32 playerID)
+    {
+        auto it = streams.find(playerID);
+        if (it != streams.end())
         {
-            SendAddOnMessage(player, GetChatCommandPrefix(), "TransmogStatus:0");
+            // A bucket halfway sent is finished so the client does not keep half a list
+            TransmogStream& stream = it->second;
+            const size_t keptEntries = stream.messageIndex > 0 ? 1 : 0;
+            if (stream.entries.size() > keptEntries)
+            {
+                stream.entries.resize(keptEntries);
+                cancelledStreams++;
+            }
+
+            if (stream.entries.empty())
+            {
+                streams.erase(it);
+            }
         }
     }
 
-    void TransmogModule::LoadDiscoveredTransmogs(const Player* player)
+    void TransmogModule::UpdateStreams()
     {
-        if (player)
+        const uint32 messagesPerPlayer = GetConfig()->streamMessagesPerPlayer ? GetConfig()->streamMessagesPerPlayer : UINT32_MAX;
+        uint32 budget = GetConfig()->streamMessagesPerUpdate ? GetConfig()->streamMessagesPerUpdate : UINT32_MAX;
+
+        // Start after the last player served so everyone gets its turn when the budget runs out
+        auto it = streams.upper_bound(lastStreamPlayer);
+        for (size_t i = 0, count = streams.size(); i < count && budget > 0; ++i)
         {
-            const uint32 playerID = player->GetObjectGuid().GetCounter();
-            auto& discoveredTransmogs = playerDiscoveredTransmogs[playerID];
-            discoveredTransmogs.clear();
+            if (it == streams.end())
+            {
+                it = streams.begin();
+            }
 
-            auto result = CharacterDatabase.PQuery("SELECT `item_entry` FROM `custom_transmog_discovered` WHERE `player` = %u", playerID);
-            if (result)
+            lastStreamPlayer = it->first;
+            Player* player = sObjectMgr.GetPlayer(ObjectGuid(HIGHGUID_PLAYER, it->first));
+            if (player)
             {
-                do
-                {
-                    Field* fields = result->Fetch();
-                    const uint32 itemEntry = fields[0].GetUInt32();
-                    if (IsValidTransmog(player, itemEntry))
-                    {
-                        AddDiscoveredTransmog(player, itemEntry, false, false);
-                    }
-                    else
-                    {
-                        sLog.outError("Item entry (Entry: %u, player ID: %u) does not exist, ignoring.", itemEntry, playerID);
-                        CharacterDatabase.PExecute("DELETE FROM `custom_transmog_discovered` WHERE `item_entry` = %u", itemEntry);
-                    }
-                } 
-                while (result->NextRow());
+                uint32 playerBudget = std::min(budget, messagesPerPlayer);
+                const uint32 maxMessages = playerBudget;
+                SendStream(player, it->second, playerBudget);
+                streamedMessages += maxMessages - playerBudget;
+                budget -= maxMessages - playerBudget;
+            }
+
+            if (!player || it->second.entries.empty())
+            {
+                it = streams.erase(it);
             }
             else
             {
-                // Calculate all available transmog from the items in the inventory
-                auto CheckTransmogItem = [&](Item* inventoryItem)
-                {
-                    const uint32 itemEntry = inventoryItem->GetEntry();
-                    if (IsValidTransmog(player, itemEntry))
-                    {
-                        AddDiscoveredTransmog(player, itemEntry, false, true);
-                    }
-                };
-
-                helper::ForEachEquippedItem(player, CheckTransmogItem);
+                ++it;
             }
         }
     }
 
-    void TransmogModule::AddDiscoveredTransmog(const Player* player, uint32 itemEntry, bool sendToClient, bool addToDB)
+    void TransmogModule::SendPendingDiscoveries()
     {
-        const uint32 playerID = player->GetObjectGuid().GetCounter();
-        auto it = playerDiscoveredTransmogs.find(playerID);
-        if (it != playerDiscoveredTransmogs.end())
+        for (const auto& pair : pendingDiscoveries)
         {
-            auto& availableTransmogs = it->second;
-            if (const ItemPrototype* proto = sObjectMgr.GetItemPrototype(itemEntry))
+            if (Player* player = sObjectMgr.GetPlayer(ObjectGuid(HIGHGUID_PLAYER, pair.first)))
             {
-                if (availableTransmogs.find(proto->DisplayInfoID) == availableTransmogs.end())
-                {
-                    TransmogItem transmogItem;
-                    transmogItem.itemClass = proto->Class;
-                    transmogItem.itemSubclass = proto->SubClass;
-                    transmogItem.itemID = proto->ItemId;
-                    transmogItem.displayID = proto->DisplayInfoID;
-
-                    if (player->ViableEquipSlots(proto, &transmogItem.slots[0]))
-                    {
-                        if (addToDB)
-                        {
-                            CharacterDatabase.PExecute("INSERT INTO `custom_transmog_discovered` (`player`, `item_entry`) VALUES (%u, %u)", playerID, transmogItem.itemID);
-                        }
-
-                        availableTransmogs.insert(std::make_pair(transmogItem.displayID, transmogItem));
+                SendDiscoveryDelta(player, pair.second);
+            }
+        }
 
-                        if (sendToClient)
-                        {
-                            // Send message to client addon when new item has been discovered
-                            SendAddOnMessage(player, GetChatCommandPrefix(), helper::FormatString("NewTransmog:%u", transmogItem.itemID));
+        pendingDiscoveries.clear();
+    }
 
-                            // Refresh the client addon available transmogs
-                             for (uint8 slot : transmogItem.slots)
-                            {
-                                if (slot != NULL_SLOT)
-                                {
-                                    SendDiscoveredTransmogs(player, slot, transmogItem.itemClass, transmogItem.itemSubclass);
-                                }
-                            }
-                        }
-                    }
+    void TransmogModule::SendDiscoveryDelta(const Player* player, const std::vector<uint32>& indexes)
+    {
+        TransmogCollectionIndex* collectionIndex = GetCollectionIndex(player);
+        if (!collectionIndex)
+            return;
+
+        // New items of each bucket
+        const uint8 playerFlags = catalog.GetPlayerFlags(player);
+        std::map<std::pair<uint8, uint32>, std::vector<uint32>> addedItems;
+        for (const uint32 index : indexes)
+        {
+            const TransmogCatalogEntry& entry = catalog.GetEntry(index);
+            const uint32 slotMask = catalog.GetSlotMask(entry, playerFlags);
+            for (uint8 slot = EQUIPMENT_SLOT_START; slot < EQUIPMENT_SLOT_END; ++slot)
+            {
+                if (slotMask & (1U << slot))
+                {
+                    addedItems[std::make_pair(slot, entry.itemClass + entry.itemSubclass)].push_back(entry.itemID);
                 }
             }
         }
-    }
 
-    void TransmogModule::SendDiscoveredTransmogs(const Player* player, int8 slot, int8 itemClass, int8 itemSubclass)
-    {
-        const auto& discoveredTransmogs = playerDiscoveredTransmogs[player->GetObjectGuid().GetCounter()];
+        // AddedTransmogs:slot:itemClass+itemSubclass:amount:packed ids[:slot:itemClass+itemSubclass:amount:packed ids...]
+        // The amount is the size of the whole list, a bucket too big for one message continues on the next one
+        const uint32 playerID = player->GetObjectGuid().GetCounter();
+        auto streamIt = streams.find(playerID);
 
-        // Sort by item types
-        //        slot            item class + item subclass      item id
-        std::map <uint8, std::map<uint32, std::vector<uint32>>> discoveredTransmogsFormatted;
-        for (const auto& pair : discoveredTransmogs)
+        std::vector<std::string> messages;
+        std::string message;
+        for (auto& added : addedItems)
         {
-            const TransmogItem& transmogItem = pair.second;
+            const uint8 slot = added.first.first;
+            const uint32 transmogItemClass = added.first.second;
 
-            if (itemClass >= 0 && itemClass != transmogItem.itemClass)
+            // Buckets waiting in the stream are encoded again with the new items
+            if (streamIt != streams.end() && IsBucketQueued(streamIt->second, slot, transmogItemClass))
                 continue;
 
-            if (itemSubclass >= 0 && itemSubclass != transmogItem.itemSubclass)
+            std::map<uint32, TransmogIndexBucket>& buckets = collectionIndex->GetSlotBuckets(slot);
+            auto bucketIt = buckets.find(transmogItemClass);
+            if (bucketIt == buckets.end())
                 continue;
 
-            const uint32 transmogItemClass = transmogItem.itemClass + transmogItem.itemSubclass;
-            for (uint8 transmogSlot : transmogItem.slots)
+            const std::string bucketHeader = helper::FormatString("%u:%u:%u:", slot, transmogItemClass, (uint32)bucketIt->second.indexes.size());
+            std::vector<uint32>& itemIDs = added.second;
+            std::sort(itemIDs.begin(), itemIDs.end());
+
+            uint32 previousItemID = 0;
+            bool writingBucket = false;
+            for (const uint32 itemID : itemIDs)
             {
-                if (slot >= 0 && slot != transmogSlot)
-                    continue;
+                if (writingBucket && message.size() + TRANSMOG_MAX_PACKED_ID_LENGTH > TRANSMOG_ADDON_TEXT_LIMIT)
+                {
+                    writingBucket = false;
+                }
 
-                if (transmogSlot != NULL_SLOT)
+                if (!writingBucket)
                 {
-                    bool front = false;
-                    if (Item* item = player->GetItemByPos(INVENTORY_SLOT_BAG_0, transmogSlot))
+                    if (!message.empty() && message.size() + 1 + bucketHeader.size() + TRANSMOG_MAX_PACKED_ID_LENGTH > TRANSMOG_ADDON_TEXT_LIMIT)
                     {
-                        front = item->GetEntry() == transmogItem.itemID;
+                        messages.push_back(std::move(message));
+                        message.clear();
                     }
 
-                    if (front)
-                    {
-                        discoveredTransmogsFormatted[transmogSlot][transmogItemClass].insert(discoveredTransmogsFormatted[transmogSlot][transmogItemClass].begin(), transmogItem.itemID);
-                    }
-                    else
-                    {
-                        discoveredTransmogsFormatted[transmogSlot][transmogItemClass].push_back(transmogItem.itemID);
-                    }
+                    message += message.empty() ? "AddedTransmogs:" : ":";
+                    message += bucketHeader;
+                    previousItemID = 0;
+                    writingBucket = true;
                 }
+
+                AppendPackedID(message, itemID, previousItemID);
             }
         }
 
-        for (auto& itemSlotIt : discoveredTransmogsFormatted)
+        if (!message.empty())
         {
-            const uint8 itemSlot = itemSlotIt.first;
-            for (auto& itemClassIt : itemSlotIt.second)
-            {
-                const uint8 itemClass = itemClassIt.first;
-                const std::vector<uint32>& itemIDs = itemClassIt.second;
-                const uint32 amount = itemIDs.size();
+            messages.push_back(std::move(message));
+        }
 
-                SendAddOnMessage(player, GetChatCommandPrefix(), helper::FormatString
-                (
-                    "AvailableTransmogs:%u:%u:%u:%s",
-                    itemSlot,
-                    itemClass,
-                    amount,
-                    "start"
-                ));
+        for (const std::string& deltaMessage : messages)
+        {
+            QueueAddonMessage(player, deltaMessage);
+        }
 
-                uint32 itemIDCounter = 0;
-                constexpr uint32 itemIDLimit = 10;
+        discoveryDeltaMessages += messages.size();
+        coalescedDiscoveries += indexes.size();
 
-                bool first = true;
-                std::ostringstream out;
-                for (uint32 itemID : itemIDs)
-                {
-                    if (first)
-                    {
-                        first = false;
-                        out << itemID;
-                    }
-                    else
-                    {
-                        out << ":" << itemID;
-                    }
+        if (versionedPlayers.find(playerID) != versionedPlayers.end())
+        {
+            QueueCollectionVersion(player);
+        }
+    }
+
+    void TransmogModule::SendTransmogPage(const Player* player, const TransmogPageRequest& request)
+    {
+        TransmogCollectionIndex* collectionIndex = GetCollectionIndex(player);
+        if (!collectionIndex)
+            return;
+
+        uint32 equippedItemID = 0;
+        if (Item* item = player->GetItemByPos(INVENTORY_SLOT_BAG_0, request.slot))
+        {
+            equippedItemID = item->GetEntry();
+        }
+
+        // An empty list is still answered so the client knows there is nothing to show
+        uint32 total = 0;
+        std::vector<uint32> itemIDs;
+        std::map<uint32, TransmogIndexBucket>& buckets = collectionIndex->GetSlotBuckets(request.slot);
+        auto bucketIt = buckets.find(request.itemClass);
+        if (bucketIt != buckets.end())
+        {
+            total = bucketIt->second.indexes.size();
+            const uint64 offset = uint64(request.page - 1) * request.pageSize;
+            if (offset < total)
+            {
+                collectionIndex->GetPage(catalog, bucketIt->second, equippedItemID, request.descending, uint32(offset), request.pageSize, itemIDs);
+            }
+        }
 
-                    itemIDCounter++;
+        // TransmogPage:slot:itemClass+itemSubclass:page:total:ids (packed or separated by ':')[:packed item infos]
+        // A page too long for one message is sent without its last items instead of being cut
+        TransmogAddonMessage message;
+        const uint8 protocol = GetAddonProtocol(player->GetObjectGuid().GetCounter());
+        while (true)
+        {
+            message.Clear();
+            message << "TransmogPage:" << uint32(request.slot) << ':' << request.itemClass << ':' << request.page << ':' << total << ':';
+            if (protocol >= TRANSMOG_PROTOCOL_PACKED)
+            {
+                uint32 previousItemID = 0;
+                for (const uint32 itemID : itemIDs)
+                {
+                    AppendPackedID(message, itemID, previousItemID);
+                }
 
-                    if (itemIDCounter >= itemIDLimit)
+                if (protocol >= TRANSMOG_PROTOCOL_ITEM_INFO)
+                {
+                    message << ':';
+                    for (const uint32 itemID : itemIDs)
                     {
-                        SendAddOnMessage(player, GetChatCommandPrefix(), helper::FormatString
-                        (
-                            "AvailableTransmogs:%u:%u:%u:%s",
-                            itemSlot,
-                            itemClass,
-                            amount,
-                            out.str().c_str()
-                        ));
-
-                        itemIDCounter = 0;
-                        first = true;
-                        out.str("");
+                        const TransmogCatalogEntry* entry = catalog.Find(itemID);
+                        AppendPackedNumber(message, GetPackedItemInfo(entry->inventoryType, entry->quality));
                     }
                 }
-
-                if (!out.str().empty())
+            }
+            else
+            {
+                for (size_t i = 0; i < itemIDs.size(); ++i)
                 {
-                    SendAddOnMessage(player, GetChatCommandPrefix(), helper::FormatString
-                    (
-                        "AvailableTransmogs:%u:%u:%u:%s",
-                        itemSlot,
-                        itemClass,
-                        amount,
-                        out.str().c_str()
-                    ));
+                    message << (i ? ":" : "") << itemIDs[i];
                 }
+            }
+
+            if (!message.IsTruncated() || itemIDs.empty())
+                break;
+
+            itemIDs.pop_back();
+        }
+
+        SendAddonResponse(player, message);
+        sentPages++;
+    }
+
+    void TransmogModule::SendPendingTransmogPage(const Player* player)
+    {
+        auto it = pendingPageRequests.find(player->GetObjectGuid().GetCounter());
+        if (it != pendingPageRequests.end())
+        {
+            const TransmogPageRequest request = it->second;
+            pendingPageRequests.erase(it);
+            SendTransmogPage(player, request);
+        }
+    }
+
+    void TransmogModule::BuildCollectionIndex(const Player* player, const TransmogCollection& collection, uint8 playerFlags, TransmogCollectionIndex& collectionIndex)
+    {
+        collectionIndex.Clear();
+
+        std::vector<uint32> selection;
+        collection.Intersect(catalog.GetFilter(-1, -1, -1, playerFlags), selection);
+
+        // An account wide collection may have several items of the same appearance, only the first usable one is sent
+        std::unordered_set<uint32> indexedDisplayGroups;
+        for (const uint32 index : selection)
+        {
+            const TransmogCatalogEntry& entry = catalog.GetEntry(index);
+            if (GetConfig()->accountWide && (!catalog.CanUse(entry, player) || !indexedDisplayGroups.insert(entry.displayGroup).second))
+                continue;
 
-                SendAddOnMessage(player, GetChatCommandPrefix(), helper::FormatString
-                (
-                    "AvailableTransmogs:%u:%u:%u:%s",
-                    itemSlot,
-                    itemClass,
-                    amount,
-                    "end"
-                ));
+            AddToCollectionIndex(entry, playerFlags, collectionIndex);
+        }
+
+        collectionIndex.SetBuilt(collection.Size(), playerFlags);
+    }
+
+    void TransmogModule::AddToCollectionIndex(const TransmogCatalogEntry& entry, uint8 playerFlags, TransmogCollectionIndex& collectionIndex) const
+    {
+        const uint32 slotMask = catalog.GetSlotMask(entry, playerFlags);
+        for (uint8 slot = EQUIPMENT_SLOT_START; slot < EQUIPMENT_SLOT_END; ++slot)
+        {
+            if (slotMask & (1U << slot))
+            {
+                collectionIndex.Add(slot, entry.itemClass + entry.itemSubclass, catalog.GetIndex(entry));
             }
         }
     }
@@ -888,7 +2205,7 @@ namespace cmangos_module
         return result;
     }
 
-    void TransmogModule::SendTransmogCost(const Player* player, const std::vector<std::pair<uint32, uint32>>& slots) const
+    void TransmogModule::SendTransmogCost(const Player* player, const TransmogSlotList& slots) const
     {
         if (player)
         {
@@ -913,13 +2230,196 @@ namespace cmangos_module
                 canPurchase = tokenID ? player->HasItemCount(tokenID, cost) : player->GetMoney() >= cost;
             }
 
-            SendAddOnMessage(player, GetChatCommandPrefix(), helper::FormatString
-            (
-                "TransmogCost:%u:%u:%u",
-                cost,
-                tokenID,
-                canPurchase ? 1 : 0
-            ));
+            TransmogAddonMessage message;
+            message << "TransmogCost:" << cost << ':' << tokenID << ':' << (canPurchase ? "1" : "0");
+            SendAddOnMessage(player, GetChatCommandPrefix(), message);
+        }
+    }
+
+    void TransmogModule::QueueActiveTransmog(uint32 playerID, uint32 itemGUID, uint32 transmogEntry)
+    {
+        // The cached state of the player would no longer match the database
+        playerCache.Erase(playerID);
+
+        if (GetPendingWritesCount() == 0)
+        {
+            oldestPendingWriteTime = WorldTimer::getMSTime();
+        }
+
+        // Only the latest change of each item is relevant
+        pendingActiveTransmogs[itemGUID] = { playerID, transmogEntry };
+        maxPendingWrites = std::max(maxPendingWrites, GetPendingWritesCount());
+
+        if (GetConfig()->flushInterval == 0)
+        {
+            FlushPendingWrites();
+        }
+    }
+
+    void TransmogModule::QueueDiscoveredTransmog(uint32 playerID, uint32 collectionOwner, uint32 itemEntry)
+    {
+        // The cached state of the player would no longer match the database
+        playerCache.Erase(playerID);
+
+        if (GetPendingWritesCount() == 0)
+        {
+            oldestPendingWriteTime = WorldTimer::getMSTime();
+        }
+
+        pendingDiscoveredTransmogs.insert(std::make_pair(collectionOwner, itemEntry));
+        maxPendingWrites = std::max(maxPendingWrites, GetPendingWritesCount());
+
+        if (GetConfig()->flushInterval == 0)
+        {
+            FlushPendingWrites();
+        }
+    }
+
+    void TransmogModule::DiscardPendingWrites(uint32 playerID)
+    {
+        for (auto it = pendingActiveTransmogs.begin(); it != pendingActiveTransmogs.end();)
+        {
+            if (it->second.playerID == playerID)
+            {
+                it = pendingActiveTransmogs.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        // The discoveries of an account wide collection still belong to the other characters
+        if (!GetConfig()->accountWide)
+        {
+            pendingDiscoveredTransmogs.erase(pendingDiscoveredTransmogs.lower_bound(std::make_pair(playerID, 0U)), pendingDiscoveredTransmogs.upper_bound(std::make_pair(playerID, UINT32_MAX)));
+        }
+    }
+
+    void TransmogModule::FlushPendingWrites(uint32 playerID, uint32 collectionOwner)
+    {
+        if (GetPendingWritesCount() == 0)
+            return;
+
+        const uint32 startTime = WorldTimer::getMSTime();
+
+        // Keep each statement well below the max query size of the database
+        constexpr uint32 rowsPerStatement = 500;
+
+        auto ExecuteStatement = [this](std::string& query, uint32& rows, const char* suffix)
+        {
+            if (rows > 0)
+            {
+                query += suffix;
+                CharacterDatabase.Execute(query.c_str());
+                flushedRows += rows;
+                flushedStatements++;
+                query.clear();
+                rows = 0;
+            }
+        };
+
+        std::string replaceQuery;
+        std::string deleteQuery;
+        uint32 replaceRows = 0;
+        uint32 deleteRows = 0;
+        for (auto it = pendingActiveTransmogs.begin(); it != pendingActiveTransmogs.end();)
+        {
+            const uint32 itemGUID = it->first;
+            const PendingActiveTransmog& pending = it->second;
+            if (playerID && pending.playerID != playerID)
+            {
+                ++it;
+                continue;
+            }
+
+            if (pending.transmogEntry)
+            {
+                replaceQuery += replaceRows == 0 ? "REPLACE INTO `custom_transmog_active` (`item_guid`, `transmog_entry`, `player`) VALUES " : ",";
+                replaceQuery += helper::FormatString("(%u, %u, %u)", itemGUID, pending.transmogEntry, pending.playerID);
+                if (++replaceRows >= rowsPerStatement)
+                {
+                    ExecuteStatement(replaceQuery, replaceRows, "");
+                }
+            }
+            else
+            {
+                deleteQuery += deleteRows == 0 ? "DELETE FROM `custom_transmog_active` WHERE `item_guid` IN (" : ",";
+                deleteQuery += std::to_string(itemGUID);
+                if (++deleteRows >= rowsPerStatement)
+                {
+                    ExecuteStatement(deleteQuery, deleteRows, ")");
+                }
+            }
+
+            it = pendingActiveTransmogs.erase(it);
+        }
+
+        ExecuteStatement(replaceQuery, replaceRows, "");
+        ExecuteStatement(deleteQuery, deleteRows, ")");
+
+        // The discovered set is ordered by collection owner so a single player flush is a contiguous range
+        auto begin = playerID ? pendingDiscoveredTransmogs.lower_bound(std::make_pair(collectionOwner, 0U)) : pendingDiscoveredTransmogs.begin();
+        auto end = playerID ? pendingDiscoveredTransmogs.upper_bound(std::make_pair(collectionOwner, UINT32_MAX)) : pendingDiscoveredTransmogs.end();
+
+        std::string insertQuery;
+        uint32 insertRows = 0;
+        if (IsBlobStorage())
+        {
+            // Append a segment per collection with the new discoveries (already sorted by the set)
+            std::vector<uint32> itemEntries;
+            for (auto it = begin; it != end;)
+            {
+                const uint32 discoveredOwner = it->first;
+                itemEntries.clear();
+                for (; it != end && it->first == discoveredOwner; ++it)
+                {
+                    itemEntries.push_back(it->second);
+                }
+
+                std::string data;
+                EncodeTransmogSegment(itemEntries, data);
+
+                insertQuery += insertRows == 0 ? helper::FormatString("INSERT INTO `%s` (`%s`, `version`, `segments`, `data`) VALUES ", GetCollectionTable(), GetOwnerColumn()) : ",";
+                insertQuery += helper::FormatString("(%u, %u, 1, X'%s')", discoveredOwner, TRANSMOG_BLOB_VERSION, data.c_str());
+                if (++insertRows >= rowsPerStatement)
+                {
+                    ExecuteStatement(insertQuery, insertRows, " ON DUPLICATE KEY UPDATE `data` = CONCAT(`data`, VALUES(`data`)), `segments` = `segments` + 1");
+                }
+            }
+
+            ExecuteStatement(insertQuery, insertRows, " ON DUPLICATE KEY UPDATE `data` = CONCAT(`data`, VALUES(`data`)), `segments` = `segments` + 1");
+        }
+        else
+        {
+            for (auto it = begin; it != end; ++it)
+            {
+                insertQuery += insertRows == 0 ? helper::FormatString("INSERT IGNORE INTO `%s` (`%s`, `item_entry`) VALUES ", GetDiscoveredTable(), GetOwnerColumn()) : ",";
+                insertQuery += helper::FormatString("(%u, %u)", it->first, it->second);
+                if (++insertRows >= rowsPerStatement)
+                {
+                    ExecuteStatement(insertQuery, insertRows, "");
+                }
+            }
+
+            ExecuteStatement(insertQuery, insertRows, "");
+        }
+        pendingDiscoveredTransmogs.erase(begin, end);
+
+        const uint32 now = WorldTimer::getMSTime();
+        lastFlushLatency = WorldTimer::getMSTimeDiff(oldestPendingWriteTime, now);
+        maxFlushLatency = std::max(maxFlushLatency, lastFlushLatency);
+        lastFlushDuration = WorldTimer::getMSTimeDiff(startTime, now);
+
+        // A partial flush (single player) keeps the timer running for the remaining writes
+        if (GetPendingWritesCount() == 0)
+        {
+            flushTimer = 0;
         }
     }
+
+    uint32 TransmogModule::GetPendingWritesCount() const
+    {
+        return pendingActiveTransmogs.size() + pendingDiscoveredTransmogs.size();
+    }
 }
\ No newline at end of file
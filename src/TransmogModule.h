@@ -3,23 +3,89 @@
 
 #include "Module.h"
 #include "TransmogModuleConfig.h"
+#include "TransmogCache.h"
+#include "TransmogAppearanceIndex.h"
+#include "TransmogCatalog.h"
+#include "TransmogCollection.h"
+#include "TransmogCollectionIndex.h"
+#include "TransmogRateLimiter.h"
+#include "TransmogAddonMessage.h"
+#include "TransmogSlotList.h"
+#include "TransmogPageRequest.h"
 
+#include <array>
+#include <deque>
 #include <unordered_map>
 #include <map>
+#include <memory>
+#include <set>
+#include <unordered_set>
 
 namespace cmangos_module
 {
-    typedef std::unordered_map<ObjectGuid, uint32> Transmog2Data;
-    typedef std::unordered_map<uint32, Transmog2Data> TransmogMap;
-    typedef std::unordered_map<ObjectGuid, uint32> TransmogData;
+    struct PendingActiveTransmog
+    {
+        uint32 playerID;
+        uint32 transmogEntry; // 0 means the row must be deleted
+    };
+
+    struct TransmogEquippedSlot
+    {
+        uint32 itemGUID;
+        uint32 transmogEntry;
+    };
+
+    struct TransmogPlayerState
+    {
+        // Resolved transmog of each equipped item, indexed by equipment slot
+        std::array<TransmogEquippedSlot, TRANSMOG_EQUIPMENT_SLOTS> equippedSlots = {};
+    };
+
+    struct TransmogCachedPlayer
+    {
+        uint8 race = 0;
+        std::vector<std::pair<uint32, uint32>> activeTransmogs;
+        bool collectionLoaded = false;
+        std::shared_ptr<TransmogCollection> discoveredTransmogs;
+    };
+
+    // Discovered transmogs read from the database, either rows or a collection blob
+    struct TransmogStoredCollection
+    {
+        std::vector<uint32> itemEntries;
+        uint32 legacyRows = 0;
+        uint32 segments = 0;
+    };
+
+    struct TransmogLazyCollection
+    {
+        bool loading = false;
+        bool sendWhenLoaded = false;
+        std::vector<uint32> discoveries;
+    };
+
+    enum TransmogStreamEntryType : uint8
+    {
+        TRANSMOG_STREAM_MESSAGE,  // Fixed addon message
+        TRANSMOG_STREAM_BUCKET,   // Every message of a slot and item class list
+        TRANSMOG_STREAM_VERSION,  // Collection version, read when it is sent
+    };
+
+    struct TransmogStreamEntry
+    {
+        uint8 type = TRANSMOG_STREAM_MESSAGE;
+        uint8 slot = 0;
+        uint32 itemClass = 0;
+        std::string message;
+    };
 
-    struct TransmogItem
+    // Collection messages waiting to be sent to a player, a few on each world update (Transmog.StreamMessagesPerPlayer)
+    struct TransmogStream
     {
-        uint8 slots[4];
-        uint8 itemClass;
-        uint8 itemSubclass;
-        uint32 itemID;
-        uint32 displayID;
+        std::deque<TransmogStreamEntry> entries;
+
+        // Messages of the first bucket already sent
+        uint32 messageIndex = 0;
     };
 
     class TransmogModule : public Module
@@ -30,6 +96,7 @@ namespace cmangos_module
 
         // Module Hooks
         void OnInitialize() override;
+        void OnUpdate(uint32 elapsed) override;
 
         // Player hooks
         void OnLoadFromDB(Player* player) override;
@@ -41,40 +108,188 @@ namespace cmangos_module
 
         // Commands
         std::vector<ModuleChatCommand>* GetCommandTable() override;
-        const char* GetChatCommandPrefix() const override { return "transmog"; }
+        const char* GetChatCommandPrefix() const override { return TRANSMOG_ADDON_PREFIX; }
+        bool HandleHandshake(WorldSession* session, const std::string& args);
         bool HandleTransmogStatus(WorldSession* session, const std::string& args);
         bool HandleGetAvailableTransmogs(WorldSession* session, const std::string& args);
+        bool HandleGetAvailableTransmogsPage(WorldSession* session, const std::string& args);
         bool HandleCalculateTransmogCost(WorldSession* session, const std::string& args);
         bool HandleApplyTransmog(WorldSession* session, const std::string& args);
+        bool HandleTransmogStats(WorldSession* session, const std::string& args);
 
     private:
         void UpdateItemAppearance(Player* player, Item* item) const;
         uint32 GetTransmogAppearance(const Item* item) const;
         
-        bool ApplyTransmog(Player* player, Item* item, uint32 transmogItemID, bool updateVisibility);
+        void SetTransmogAppearance(uint32 playerID, const Item* item, uint32 transmogItemID);
+        bool ApplyTransmogs(Player* player, const TransmogSlotList& slots, uint32 cost, uint32 tokenID);
         bool RemoveTransmog(Player* player, Item* item, bool updateVisibility);
 
+        bool IsTrackedPlayer(uint32 playerID) const
+        {
+            const uint32 word = playerID >> 6;
+            return word < trackedPlayers.size() && (trackedPlayers[word] >> (playerID & 63)) & 1;
+        }
+
+        void SetTrackedPlayer(uint32 playerID, bool tracked);
+
+        TransmogPlayerState* GetPlayerState(uint32 playerID);
+        const TransmogPlayerState* GetPlayerState(uint32 playerID) const;
+        void UpdateEquippedSlot(TransmogPlayerState& playerState, const Item* item) const;
+
         bool IsItemTransmogrified(const Item* item) const;
         std::vector<std::pair<Item*, uint32>> GetTransmogrifiedItems(const Player* player, bool equipped = false) const;
 
-        bool IsValidTransmog(const Player* player, const ItemPrototype* itemPrototype) const;
         bool IsValidTransmog(const Player* player, uint32 itemEntry) const;
 
-        void LoadActiveTransmogs(Player* player);
+        void HandleTransmogsLoaded(QueryResult* queryResult, uint32 playerID);
+        void LoadCachedTransmogs(Player* player, TransmogCachedPlayer& cachedPlayer);
+
+        void LoadActiveTransmogs(Player* player, const std::vector<std::pair<uint32, uint32>>& activeTransmogs);
         void SendActiveTransmogs(const Player* player);
 
-        void LoadDiscoveredTransmogs(const Player* player);
+        void LoadDiscoveredTransmogs(const Player* player, const std::vector<uint32>& itemEntries);
+        void LoadDiscoveredTransmogsIfNeeded(const Player* player, bool sendWhenLoaded);
+        void HandleDiscoveredTransmogsLoaded(QueryResult* queryResult, uint32 playerID);
+        void ReadStoredTransmog(Field* fields, uint32 playerID, std::vector<std::pair<uint32, uint32>>& activeTransmogs, TransmogStoredCollection& storedCollection) const;
+        void FinishStoredCollection(uint32 collectionOwner, TransmogStoredCollection& storedCollection);
+        void FinishLazyCollection(const Player* player, const TransmogLazyCollection& lazyCollection);
+
+        // Collections belong to the account with Transmog.AccountWide, otherwise to the character
+        uint32 GetCollectionOwner(const Player* player) const;
+        std::shared_ptr<TransmogCollection> FindSharedCollection(uint32 collectionOwner);
+        const char* GetDiscoveredTable() const { return GetConfig()->accountWide ? "custom_transmog_account_discovered" : "custom_transmog_discovered"; }
+        const char* GetCollectionTable() const { return GetConfig()->accountWide ? "custom_transmog_account_collection" : "custom_transmog_collection"; }
+        const char* GetOwnerColumn() const { return GetConfig()->accountWide ? "account" : "player"; }
+
+        bool IsBlobStorage() const { return GetConfig()->collectionStorage == TRANSMOG_STORAGE_BLOB; }
+        void MigrateDiscoveredTransmogs();
+        void HandleMigrationBatchLoaded(QueryResult* queryResult, uint32 param);
         void AddDiscoveredTransmog(const Player* player, uint32 itemEntry, bool sendToClient, bool addToDB);
+        bool HasDiscoveredAppearance(const TransmogCollection& collection, const TransmogCatalogEntry& entry, const Player* player) const;
         void SendDiscoveredTransmogs(const Player* player, int8 slot = -1, int8 itemClass = -1, int8 itemSubclass = -1);
+        uint8 GetAddonProtocol(uint32 playerID) const;
+        bool CanRunCommand(const Player* player, TransmogCommand command);
+        void SyncDiscoveredTransmogs(const Player* player);
+        void SendCollectionVersion(const Player* player);
+        uint64 GetCollectionVersion(uint64 collectionHash, uint8 playerFlags) const;
+        TransmogCollectionIndex* GetCollectionIndex(const Player* player);
+        bool SendCollectionBucket(const Player* player, uint8 slot, uint32 transmogItemClass, uint32& messageIndex, uint32& budget);
+        void SendAddonResponse(const Player* player, const std::string& message);
+        void SendAddonResponse(const Player* player, const TransmogAddonMessage& message);
+        void SendTransmogPage(const Player* player, const TransmogPageRequest& request);
+        void SendPendingTransmogPage(const Player* player);
+
+        // Outbound stream of the collection messages
+        void QueueAddonMessage(const Player* player, const std::string& message);
+        void QueueCollectionBucket(const Player* player, uint8 slot, uint32 transmogItemClass);
+        bool IsBucketQueued(const TransmogStream& stream, uint8 slot, uint32 transmogItemClass, size_t firstEntry = 0) const;
+        void QueueCollectionVersion(const Player* player);
+        void SendStreamIfNotPaced(const Player* player);
+        void SendStream(const Player* player, TransmogStream& stream, uint32& budget);
+        void CancelStream(uint32 playerID);
+        void UpdateStreams();
+
+        // Items discovered during the last world update, sent together to the addons that merge them
+        void SendPendingDiscoveries();
+        void SendDiscoveryDelta(const Player* player, const std::vector<uint32>& indexes);
+        void BuildCollectionIndex(const Player* player, const TransmogCollection& collection, uint8 playerFlags, TransmogCollectionIndex& collectionIndex);
+        void AddToCollectionIndex(const TransmogCatalogEntry& entry, uint8 playerFlags, TransmogCollectionIndex& collectionIndex) const;
 
         std::pair<uint32, uint32> CalculateTransmogCost(uint32 itemEntry) const;
-        void SendTransmogCost(const Player* player, const std::vector<std::pair<uint32, uint32>>& slots) const;
+        void SendTransmogCost(const Player* player, const TransmogSlotList& slots) const;
+
+        void QueueActiveTransmog(uint32 playerID, uint32 itemGUID, uint32 transmogEntry);
+        void QueueDiscoveredTransmog(uint32 playerID, uint32 collectionOwner, uint32 itemEntry);
+        void DiscardPendingWrites(uint32 playerID);
+        void FlushPendingWrites(uint32 playerID = 0, uint32 collectionOwner = 0);
+        uint32 GetPendingWritesCount() const;
 
     private:
-        TransmogMap entryMap;
-        TransmogData dataMap;
+        TransmogCatalog catalog;
+        TransmogAppearanceIndex appearanceIndex;
+        std::unordered_map<uint32, TransmogPlayerState> playerStates;
+
+        // One bit per player guid, set for the players handled by the module (not random bots)
+        std::vector<uint64> trackedPlayers;
+        uint64 skippedHookCalls;
+
+        std::unordered_map<uint32, std::shared_ptr<TransmogCollection>> playerDiscoveredTransmogs;
+
+        // Discovered transmogs of each player grouped by slot and item class, built when they are first sent
+        std::unordered_map<uint32, TransmogCollectionIndex> collectionIndexes;
+        uint64 encodedResponses;
+        uint64 cachedResponses;
+        uint64 sentResponseMessages;
+        uint64 sentResponseBytes;
+
+        // Addon protocol agreed with each player (TransmogAddonProtocol), text if the addon never sent the handshake
+        std::unordered_map<uint32, uint8> addonProtocols;
+
+        // Collection versions sent by the client addons (GetAvailableTransmogs <version>) waiting for the collection to be loaded,
+        // and the players whose addon keeps the collection between sessions
+        std::unordered_map<uint32, uint64> clientVersions;
+        std::unordered_set<uint32> versionedPlayers;
+        uint64 catalogChecksum;
+        uint64 currentSyncs;
+        uint64 deltaSyncs;
+        uint64 fullSyncs;
+
+        // Last page asked by each player before its collection was loaded
+        std::unordered_map<uint32, TransmogPageRequest> pendingPageRequests;
+        uint64 sentPages;
+
+        // Collection messages queued per player, sorted so the players take turns from the last one served
+        std::map<uint32, TransmogStream> streams;
+        uint32 lastStreamPlayer;
+        uint64 streamedMessages;
+        uint64 cancelledStreams;
+
+        // Catalog positions of the items discovered by each player since the last world update (TRANSMOG_PROTOCOL_DELTA)
+        std::unordered_map<uint32, std::vector<uint32>> pendingDiscoveries;
+        uint64 discoveryDeltaMessages;
+        uint64 coalescedDiscoveries;
+
+        // Loaded account wide collections, shared by the online characters of the account
+        std::unordered_map<uint32, std::weak_ptr<TransmogCollection>> sharedCollections;
+
+        // Players waiting for their transmog state to be loaded, and the ones among them whose addon already asked for the collection
+        std::unordered_set<uint32> loadingPlayers;
+        std::unordered_set<uint32> collectionRequests;
+
+        // Players whose discovered transmogs have not been loaded yet (Transmog.LazyCollection)
+        std::unordered_map<uint32, TransmogLazyCollection> lazyCollections;
+
+        // State of recently logged out players
+        TransmogLRUCache<uint32, TransmogCachedPlayer> playerCache;
+        uint64 cacheHits;
+        uint64 cacheMisses;
+
+        // Limit of the addon commands each player can send (Transmog.RateLimitTokens)
+        TransmogRateLimiter rateLimiter;
+
+        // Write-behind queue, merged per item guid and per (collection owner, item entry)
+        std::unordered_map<uint32, PendingActiveTransmog> pendingActiveTransmogs;
+        std::set<std::pair<uint32, uint32>> pendingDiscoveredTransmogs;
+        uint32 flushTimer;
+        uint32 oldestPendingWriteTime;
+
+        // Write-behind statistics
+        uint32 maxPendingWrites;
+        uint32 lastFlushLatency;
+        uint32 maxFlushLatency;
+        uint32 lastFlushDuration;
+        uint64 flushedRows;
+        uint64 flushedStatements;
 
-        std::unordered_map<uint32, std::map<uint32, TransmogItem>> playerDiscoveredTransmogs;
+        // Online migration of the discovered transmog rows into collection blobs (Transmog.CollectionStorage)
+        uint32 migrationTimer;
+        uint32 migrationLastOwner;
+        bool migrationRunning;
+        bool migrationFinished;
+        uint64 migratedCollections;
+        uint64 migratedRows;
+        uint64 compactedCollections;
     };
 }
 #endif
\ No newline at end of file
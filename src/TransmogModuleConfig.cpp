@@ -12,6 +12,22 @@ namespace cmangos_module
     , tokenRequired(false)
     , tokenEntry(0U)
     , tokenAmount(0U)
+    , flushInterval(1000U)
+    , flushThreshold(500U)
+    , lazyCollection(false)
+    , cacheSize(500U)
+    , cacheTTL(300U)
+    , catalogThreads(0U)
+    , catalogFile("transmog.catalog")
+    , collectionStorage(TRANSMOG_STORAGE_ROWS)
+    , compactSegments(32U)
+    , migrationBatchSize(100U)
+    , migrationInterval(1000U)
+    , accountWide(false)
+    , streamMessagesPerPlayer(10U)
+    , streamMessagesPerUpdate(200U)
+    , rateLimitTokens(20U)
+    , rateLimitRefill(5U)
     {
     
     }
@@ -24,6 +40,22 @@ namespace cmangos_module
         tokenRequired = config.GetBoolDefault("Transmog.TokenRequired", false);
         tokenEntry = config.GetIntDefault("Transmog.TokenEntry", 0U);
         tokenAmount = config.GetIntDefault("Transmog.TokenAmount", 1U);
+        flushInterval = config.GetIntDefault("Transmog.FlushInterval", 1000U);
+        flushThreshold = config.GetIntDefault("Transmog.FlushThreshold", 500U);
+        lazyCollection = config.GetBoolDefault("Transmog.LazyCollection", false);
+        cacheSize = config.GetIntDefault("Transmog.CacheSize", 500U);
+        cacheTTL = config.GetIntDefault("Transmog.CacheTTL", 300U);
+        catalogThreads = config.GetIntDefault("Transmog.CatalogThreads", 0U);
+        catalogFile = config.GetStringDefault("Transmog.CatalogFile", "transmog.catalog");
+        collectionStorage = config.GetIntDefault("Transmog.CollectionStorage", TRANSMOG_STORAGE_ROWS);
+        compactSegments = config.GetIntDefault("Transmog.CompactSegments", 32U);
+        migrationBatchSize = config.GetIntDefault("Transmog.MigrationBatchSize", 100U);
+        migrationInterval = config.GetIntDefault("Transmog.MigrationInterval", 1000U);
+        accountWide = config.GetBoolDefault("Transmog.AccountWide", false);
+        streamMessagesPerPlayer = config.GetIntDefault("Transmog.StreamMessagesPerPlayer", 10U);
+        streamMessagesPerUpdate = config.GetIntDefault("Transmog.StreamMessagesPerUpdate", 200U);
+        rateLimitTokens = config.GetIntDefault("Transmog.RateLimitTokens", 20U);
+        rateLimitRefill = config.GetIntDefault("Transmog.RateLimitRefill", 5U);
 
         if (tokenRequired)
         {
@@ -35,12 +67,24 @@ namespace cmangos_module
             }
         }
 
+        if (collectionStorage > TRANSMOG_STORAGE_BLOB)
+        {
+            sLog.outError("Transmog.CollectionStorage set to %u but it only accepts 0 or 1. Using one row per transmog", collectionStorage);
+            collectionStorage = TRANSMOG_STORAGE_ROWS;
+        }
+
         if (tokenRequired && tokenAmount == 0)
         {
             sLog.outError("Transmog.TokenAmount set to %u but it needs a minimum of 1. Setting token amount to 1", tokenAmount);
             tokenAmount = 1;
         }
 
+        if (rateLimitTokens > 0 && rateLimitRefill == 0)
+        {
+            sLog.outError("Transmog.RateLimitRefill set to %u but it needs a minimum of 1. Setting rate limit refill to 1", rateLimitRefill);
+            rateLimitRefill = 1;
+        }
+
         return true;
     }
 }
\ No newline at end of file
@@ -1,8 +1,16 @@
 #pragma once
 #include "ModuleConfig.h"
 
+#include <string>
+
 namespace cmangos_module
 {
+    enum TransmogCollectionStorage
+    {
+        TRANSMOG_STORAGE_ROWS = 0, // One row per discovered transmog
+        TRANSMOG_STORAGE_BLOB = 1, // One blob of varint delta encoded item entries per player
+    };
+
     class TransmogModuleConfig : public ModuleConfig
     {
     public:
@@ -16,5 +24,21 @@ namespace cmangos_module
         bool tokenRequired;
         uint32 tokenEntry;
         uint32 tokenAmount;
+        uint32 flushInterval;
+        uint32 flushThreshold;
+        bool lazyCollection;
+        uint32 cacheSize;
+        uint32 cacheTTL;
+        uint32 catalogThreads;
+        std::string catalogFile;
+        uint32 collectionStorage;
+        uint32 compactSegments;
+        uint32 migrationBatchSize;
+        uint32 migrationInterval;
+        bool accountWide;
+        uint32 streamMessagesPerPlayer;
+        uint32 streamMessagesPerUpdate;
+        uint32 rateLimitTokens;
+        uint32 rateLimitRefill;
     };
 }
\ No newline at end of file
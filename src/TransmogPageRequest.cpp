@@ -0,0 +1,45 @@
+#include "TransmogPageRequest.h"
+#include "TransmogSlotList.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace cmangos_module
+{
+    bool TransmogPageRequest::Parse(const char* args, size_t length)
+    {
+        const char* pos = args;
+        const char* const end = args + length;
+
+        uint32 numbers[4];
+        for (uint8 i = 0; i < 4; ++i)
+        {
+            if ((i > 0 && (pos == end || *pos++ != ':')) || !ReadTransmogNumber(pos, end, numbers[i]))
+                return false;
+        }
+
+        if (numbers[0] >= TRANSMOG_EQUIPMENT_SLOTS)
+            return false;
+
+        bool isDescending = false;
+        if (pos != end)
+        {
+            const size_t orderLength = end - pos;
+            if (orderLength == 5 && memcmp(pos, ":desc", 5) == 0)
+            {
+                isDescending = true;
+            }
+            else if (orderLength != 4 || memcmp(pos, ":asc", 4) != 0)
+            {
+                return false;
+            }
+        }
+
+        slot = uint8(numbers[0]);
+        itemClass = numbers[1];
+        page = std::max<uint32>(numbers[2], 1);
+        pageSize = std::min<uint32>(std::max<uint32>(numbers[3], 1), TRANSMOG_MAX_PAGE_SIZE);
+        descending = isDescending;
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef CMANGOS_MODULE_TRANSMOG_PAGE_REQUEST_H
+#define CMANGOS_MODULE_TRANSMOG_PAGE_REQUEST_H
+
+#include "TransmogAddonProtocol.h"
+
+#include <string>
+
+namespace cmangos_module
+{
+    // Page of a slot and item class list asked by the client addon (GetAvailableTransmogsPage)
+    struct TransmogPageRequest
+    {
+        uint8 slot = 0;
+        uint32 itemClass = 0;
+        uint32 page = 1;
+        uint32 pageSize = 0;
+        bool descending = false;
+
+        // Reads slot:itemClass+itemSubclass:page:pageSize[:asc|desc] in a single pass without allocating or throwing,
+        // the same way as TransmogSlotList. Fails on anything else and on unknown slots, the page and its size are clamped.
+        bool Parse(const char* args, size_t length);
+        bool Parse(const std::string& args) { return Parse(args.c_str(), args.size()); }
+    };
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef CMANGOS_MODULE_TRANSMOG_RATE_LIMITER_H
+#define CMANGOS_MODULE_TRANSMOG_RATE_LIMITER_H
+
+#include "Platform/Define.h"
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+
+namespace cmangos_module
+{
+    // Commands the client addon can send, each one limited on its own
+    enum TransmogCommand : uint8
+    {
+        TRANSMOG_COMMAND_HANDSHAKE,
+        TRANSMOG_COMMAND_STATUS,
+        TRANSMOG_COMMAND_AVAILABLE,
+        TRANSMOG_COMMAND_PAGE,
+        TRANSMOG_COMMAND_COST,
+        TRANSMOG_COMMAND_APPLY,
+        TRANSMOG_COMMAND_COUNT
+    };
+
+    // Token bucket per player and command. Every request takes as many tokens as the work it does
+    // and the tokens come back over time, requests without enough tokens are refused.
+    class TransmogRateLimiter
+    {
+    public:
+        TransmogRateLimiter() : capacity(0), refillPerSecond(0), throttled() {}
+
+        void SetLimits(uint32 capacity, uint32 refillPerSecond)
+        {
+            this->capacity = capacity;
+            this->refillPerSecond = refillPerSecond;
+            players.clear();
+        }
+
+        bool IsEnabled() const { return capacity > 0 && refillPerSecond > 0; }
+
+        // Takes the tokens of the request if there are enough, otherwise tells how long (in milliseconds) until there will be
+        bool Consume(uint32 playerID, uint8 command, uint32 cost, uint32 now, uint32& retryDelay)
+        {
+            // Tokens are kept in thousandths so they come back every millisecond
+            const uint64 maxTokens = uint64(capacity) * 1000;
+            const uint64 requiredTokens = std::min<uint64>(cost, capacity) * 1000;
+
+            auto it = players.find(playerID);
+            if (it == players.end())
+            {
+                // New players start with every token
+                Bucket fullBucket = { maxTokens, now };
+                std::array<Bucket, TRANSMOG_COMMAND_COUNT> buckets;
+                buckets.fill(fullBucket);
+                it = players.emplace(playerID, buckets).first;
+            }
+
+            Bucket& bucket = it->second[command];
+            bucket.tokens = std::min(maxTokens, bucket.tokens + uint64(now - bucket.lastUpdate) * refillPerSecond);
+            bucket.lastUpdate = now;
+
+            if (bucket.tokens < requiredTokens)
+            {
+                retryDelay = uint32((requiredTokens - bucket.tokens + refillPerSecond - 1) / refillPerSecond);
+                throttled[command]++;
+                return false;
+            }
+
+            bucket.tokens -= requiredTokens;
+            retryDelay = 0;
+            return true;
+        }
+
+        void ErasePlayer(uint32 playerID) { players.erase(playerID); }
+
+        uint64 GetThrottled(uint8 command) const { return throttled[command]; }
+        size_t Size() const { return players.size(); }
+
+    private:
+        struct Bucket
+        {
+            uint64 tokens;
+            uint32 lastUpdate;
+        };
+
+        uint32 capacity;
+        uint32 refillPerSecond;
+        std::unordered_map<uint32, std::array<Bucket, TRANSMOG_COMMAND_COUNT>> players;
+        std::array<uint64, TRANSMOG_COMMAND_COUNT> throttled;
+    };
+}
+#endif
\ No newline at end of file
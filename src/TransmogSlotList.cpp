@@ -0,0 +1,54 @@
+#include "TransmogSlotList.h"
+
+namespace cmangos_module
+{
+    bool ReadTransmogNumber(const char*& pos, const char* end, uint32& value)
+    {
+        const char* start = pos;
+        uint64 number = 0;
+        while (pos < end && *pos >= '0' && *pos <= '9')
+        {
+            number = number * 10 + uint32(*pos - '0');
+            if (number > UINT32_MAX)
+                return false;
+
+            ++pos;
+        }
+
+        value = uint32(number);
+        return pos != start;
+    }
+
+    bool TransmogSlotList::Parse(const char* args, size_t length)
+    {
+        amount = 0;
+
+        uint32 usedSlots = 0;
+        const char* pos = args;
+        const char* const end = args + length;
+        while (pos < end)
+        {
+            if (*pos == ',')
+            {
+                ++pos;
+                continue;
+            }
+
+            uint32 slot = 0;
+            uint32 itemID = 0;
+            if (!ReadTransmogNumber(pos, end, slot) || pos == end || *pos++ != ':' || !ReadTransmogNumber(pos, end, itemID))
+                return false;
+
+            if (pos != end && *pos != ',')
+                return false;
+
+            if (slot >= TRANSMOG_EQUIPMENT_SLOTS || (usedSlots & (1U << slot)))
+                return false;
+
+            usedSlots |= 1U << slot;
+            slots[amount++] = std::make_pair(slot, itemID);
+        }
+
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef CMANGOS_MODULE_TRANSMOG_SLOT_LIST_H
+#define CMANGOS_MODULE_TRANSMOG_SLOT_LIST_H
+
+#include "TransmogAddonProtocol.h"
+
+#include <array>
+#include <string>
+#include <utility>
+
+namespace cmangos_module
+{
+    // Reads a number of the addon arguments up to the next separator, false if there are no digits or it does not fit in 32 bits
+    bool ReadTransmogNumber(const char*& pos, const char* end, uint32& value);
+
+    // Equipment slots and transmog item ids sent by the client addon (slot:itemID,slot:itemID,...)
+    class TransmogSlotList
+    {
+    public:
+        TransmogSlotList() : amount(0) {}
+
+        // Reads the whole list in a single pass without allocating or throwing. Fails on anything
+        // that is not a number, numbers that do not fit in 32 bits, unknown slots and repeated slots.
+        // Empty entries (like the trailing comma sent by the addon) are skipped.
+        bool Parse(const char* args, size_t length);
+        bool Parse(const std::string& args) { return Parse(args.c_str(), args.size()); }
+
+        void Clear() { amount = 0; }
+
+        size_t size() const { return amount; }
+        bool empty() const { return amount == 0; }
+
+        const std::pair<uint32, uint32>* begin() const { return slots.data(); }
+        const std::pair<uint32, uint32>* end() const { return slots.data() + amount; }
+
+    private:
+        std::array<std::pair<uint32, uint32>, TRANSMOG_EQUIPMENT_SLOTS> slots;
+        uint8 amount;
+    };
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,196 @@
+// Benchmarks of the transmog hot paths that do not need a running server:
+// the catalog filters (from a catalog file saved by the server), the addon message writer
+// and the addon argument parsers, which are also fed random input to check they never fail badly.
+//
+// Usage: transmog_bench [catalog file] [iterations]
+
+#include "TransmogAddonMessage.h"
+#include "TransmogCatalog.h"
+#include "TransmogPageRequest.h"
+#include "TransmogSlotList.h"
+
+#include <bitset>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+
+using namespace cmangos_module;
+
+namespace
+{
+    typedef std::chrono::steady_clock BenchClock;
+
+    double ElapsedMs(const BenchClock::time_point& start)
+    {
+        return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+    }
+
+    // Every filter the module can ask for, built again from a freshly mapped catalog on each round
+    void BenchCatalogFilters(const std::string& path, uint32 rounds)
+    {
+        uint64 checksum = 0;
+        if (!TransmogCatalog::ReadFileChecksum(path, checksum))
+        {
+            printf("catalog: can not read %s\n", path.c_str());
+            return;
+        }
+
+        TransmogCatalog catalog;
+        double total = 0.0;
+        uint64 matches = 0;
+        for (uint32 round = 0; round < rounds; ++round)
+        {
+            if (!catalog.LoadFile(path, checksum))
+            {
+                printf("catalog: %s is not a valid catalog file\n", path.c_str());
+                return;
+            }
+
+            const BenchClock::time_point start = BenchClock::now();
+            for (int8 slot = -1; slot < int8(TRANSMOG_EQUIPMENT_SLOTS); ++slot)
+            {
+                for (int8 itemClass : { int8(-1), int8(2), int8(4) })
+                {
+                    for (int8 itemSubclass = -1; itemSubclass < 21; ++itemSubclass)
+                    {
+                        for (uint8 playerFlags = 0; playerFlags < 4; ++playerFlags)
+                        {
+                            for (const uint64 word : catalog.GetFilter(slot, itemClass, itemSubclass, playerFlags))
+                            {
+                                matches += std::bitset<64>(word).count();
+                            }
+                        }
+                    }
+                }
+            }
+
+            total += ElapsedMs(start);
+        }
+
+        printf("catalog: %zu entries, every filter built in %.3f ms (%llu matches)\n", catalog.Size(), total / rounds, (unsigned long long)matches);
+    }
+
+    // A TransmogCost answer written in place against the same text through a stream
+    void BenchAddonMessage(uint32 iterations)
+    {
+        size_t written = 0;
+        BenchClock::time_point start = BenchClock::now();
+        for (uint32 i = 0; i < iterations; ++i)
+        {
+            TransmogAddonMessage message;
+            message << "TransmogCost:" << i << ':' << (i * 7) << ':' << "1";
+            written += message.size();
+        }
+
+        const double messageTime = ElapsedMs(start);
+
+        start = BenchClock::now();
+        for (uint32 i = 0; i < iterations; ++i)
+        {
+            std::ostringstream message;
+            message << "TransmogCost:" << i << ':' << (i * 7) << ':' << "1";
+            written += message.str().size();
+        }
+
+        printf("addon message: %u messages, writer %.1f ms, ostringstream %.1f ms (%zu bytes)\n", iterations, messageTime, ElapsedMs(start), written);
+    }
+
+    void BenchParsers(uint32 iterations)
+    {
+        const std::string slotList = "0:1234,1:5678,2:9012,4:3456,5:7890,6:11111,7:22222,9:33333,15:44444,16:55555,";
+        const std::string pageRequest = "4:6:12:15:desc";
+
+        size_t parsed = 0;
+        BenchClock::time_point start = BenchClock::now();
+        for (uint32 i = 0; i < iterations; ++i)
+        {
+            TransmogSlotList slots;
+            slots.Parse(slotList);
+            parsed += slots.size();
+        }
+
+        const double slotListTime = ElapsedMs(start);
+
+        start = BenchClock::now();
+        for (uint32 i = 0; i < iterations; ++i)
+        {
+            TransmogPageRequest request;
+            parsed += request.Parse(pageRequest) ? request.pageSize : 0;
+        }
+
+        printf("parsers: %u slot lists in %.1f ms, %u page requests in %.1f ms (%zu)\n", iterations, slotListTime, iterations, ElapsedMs(start), parsed);
+    }
+
+    // Mutated client arguments must be refused or give values the module can use as they are
+    bool FuzzParsers(uint32 iterations)
+    {
+        static const char alphabet[] = "0123456789:,asdec- ";
+        const std::string seeds[] = { "0:1,", "3:100,4:200", "18:4294967295", "19:1", "1:4294967296", "1:2,1:3", ",,,", "", "4:6:2:15", "4:6:0:100:desc", "18:1:1:1:asc" };
+
+        std::mt19937 random(7);
+        uint32 accepted = 0;
+        for (uint32 i = 0; i < iterations; ++i)
+        {
+            std::string input = seeds[random() % (sizeof(seeds) / sizeof(seeds[0]))];
+            for (uint32 mutations = random() % 4; mutations > 0; --mutations)
+            {
+                const size_t pos = input.empty() ? 0 : random() % input.size();
+                switch (random() % 3)
+                {
+                    case 0: input.insert(input.begin() + pos, alphabet[random() % (sizeof(alphabet) - 1)]); break;
+                    case 1: if (!input.empty()) input.erase(pos, 1); break;
+                    default: if (!input.empty()) input[pos] = alphabet[random() % (sizeof(alphabet) - 1)]; break;
+                }
+            }
+
+            TransmogSlotList slots;
+            if (slots.Parse(input))
+            {
+                uint32 usedSlots = 0;
+                for (const auto& slot : slots)
+                {
+                    if (slot.first >= TRANSMOG_EQUIPMENT_SLOTS || (usedSlots & (1U << slot.first)))
+                    {
+                        printf("fuzz: slot list '%s' gave slot %u\n", input.c_str(), slot.first);
+                        return false;
+                    }
+
+                    usedSlots |= 1U << slot.first;
+                }
+
+                accepted++;
+            }
+
+            TransmogPageRequest request;
+            if (request.Parse(input))
+            {
+                if (request.slot >= TRANSMOG_EQUIPMENT_SLOTS || request.page == 0 || request.pageSize == 0 || request.pageSize > TRANSMOG_MAX_PAGE_SIZE)
+                {
+                    printf("fuzz: page request '%s' out of range\n", input.c_str());
+                    return false;
+                }
+
+                accepted++;
+            }
+        }
+
+        printf("fuzz: %u inputs, %u accepted\n", iterations, accepted);
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const uint32 iterations = argc > 2 ? uint32(strtoul(argv[2], nullptr, 10)) : 1000000;
+    if (argc > 1 && argv[1][0])
+    {
+        BenchCatalogFilters(argv[1], 10);
+    }
+
+    BenchAddonMessage(iterations);
+    BenchParsers(iterations);
+    return FuzzParsers(iterations) ? 0 : 1;
+}
\ No newline at end of file